@@ -0,0 +1,134 @@
+// Enrollment bitmap benchmark
+// Description: Answers "how many students are in both courses, and in either?" for random course pairs of a
+// loaded data set in three ways: walking one member list against the other (what the linked-list rosters
+// allowed), checking the smaller course's members through their schedules (the OVERLAP fallback), and the
+// EnrollmentBitmap row operations with each kernel this CPU supports.
+// Build: g++ -std=c++17 -O2 -pthread -Isrc bench/bitmap_bench.cpp $(ls src/*.cpp | grep -v main.cpp) -o bitmap_bench
+// Usage: ./bitmap_bench <course file> <enrollment file> [--pairs n]
+// Tip: ./generate_data courses.txt enrollment.txt --courses 200 --students 100000 gives well-filled courses.
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "batch.h"
+#include "course_index.h"
+#include "course_registration.h"
+#include "enrollment_bitmap.h"
+#include "student_registry.h"
+
+using namespace std;
+
+// Precondition: None.
+// Postcondition: Returns the course's enrolled and waiting students in one list.
+static vector<const Student*> membersOf(const Course& course) {
+    vector<const Student*> members(course.getRoster().getItems().begin(), course.getRoster().getItems().end());
+    for (const Student* student : course.getWaitList().getStudents())
+        members.push_back(student);
+    return members;
+}
+
+// Precondition: None.
+// Postcondition: Returns the number of students in both lists, comparing every pair with Student::equals.
+static int nestedWalk(const vector<const Student*>& first, const vector<const Student*>& second) {
+    int both = 0;
+    for (const Student* a : first)
+        for (const Student* b : second)
+            if (a->equals(b)) {
+                both++;
+                break;
+            }
+    return both;
+}
+
+// Precondition: None.
+// Postcondition: Prints the time per pair and the checksum of one method.
+static void report(const string& label, chrono::steady_clock::duration elapsed, size_t pairs, long long checksum) {
+    double ns = chrono::duration<double, nano>(elapsed).count() / pairs;
+    cout << left << setw(32) << label << right << fixed << setprecision(1) << setw(14) << ns << setw(16) << checksum
+         << endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Usage: " << argv[0] << " <course file> <enrollment file> [--pairs n]" << endl;
+        return 1;
+    }
+    size_t pairCount = 100000;
+    for (int i = 3; i + 1 < argc; i += 2)
+        if (strcmp(argv[i], "--pairs") == 0)
+            pairCount = strtoul(argv[i + 1], nullptr, 10);
+    vector<Course> courses = readFile1(argv[1]);
+    int courseCount = static_cast<int>(courses.size());
+    CourseIndex index(courses.data(), courseCount);
+    StudentRegistry registry;
+    readFile2(argv[2], courses.data(), index, registry);
+    if (courseCount == 0 || pairCount == 0) {
+        cerr << "No data loaded." << endl;
+        return 1;
+    }
+
+    mt19937 random(42);
+    uniform_int_distribution<int> pick(0, courseCount - 1);
+    vector<pair<int, int>> pairs(pairCount);
+    for (pair<int, int>& p : pairs)
+        p = {pick(random), pick(random)};
+    vector<vector<const Student*>> members(courseCount);
+    size_t memberTotal = 0;
+    for (int i = 0; i < courseCount; i++) {
+        members[i] = membersOf(courses[i]);
+        memberTotal += members[i].size();
+    }
+    cout << courseCount << " courses, " << registry.size() << " students, " << fixed << setprecision(1)
+         << double(memberTotal) / courseCount << " members per course, " << pairCount << " pairs" << endl << endl;
+    cout << left << setw(32) << "method" << right << setw(14) << "ns per pair" << setw(16) << "checksum" << endl;
+
+    // The nested walk is quadratic, so it runs on a slice of the pairs when courses are large
+    size_t walkPairs = min(pairCount, max<size_t>(100, pairCount * 1000 / max<size_t>(1, memberTotal / courseCount)));
+    long long checksum = 0;
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < walkPairs; i++) {
+        int both = nestedWalk(members[pairs[i].first], members[pairs[i].second]);
+        checksum += both + (members[pairs[i].first].size() + members[pairs[i].second].size() - both);
+    }
+    string walkLabel = "nested member walk";
+    if (walkPairs < pairCount)
+        walkLabel += " (" + to_string(walkPairs) + " pairs)";
+    report(walkLabel, chrono::steady_clock::now() - start, walkPairs, checksum);
+
+    checksum = 0;
+    start = chrono::steady_clock::now();
+    for (const pair<int, int>& p : pairs) {
+        TransactionResult result = executeOverlap(p.first, p.second, courses.data(), nullptr);
+        checksum += result.both + result.either;
+    }
+    report("schedule lookup", chrono::steady_clock::now() - start, pairCount, checksum);
+
+    EnrollmentBitmap bitmap;
+    if (!bitmap.build(courses.data(), courseCount, registry.size())) {
+        cerr << "The bitmap would need " << EnrollmentBitmap::bytesFor(courseCount, registry.size()) / (1 << 20)
+             << " MiB; skipping it." << endl;
+        return 0;
+    }
+    const char* kernels[] = {"scalar", "sse4.2", "avx2"};
+    for (const char* kernel : kernels) {
+        if (!EnrollmentBitmap::useKernel(kernel)) {
+            cout << left << setw(32) << (string("bitmap ") + kernel) << right << setw(14) << "unsupported" << endl;
+            continue;
+        }
+        checksum = 0;
+        start = chrono::steady_clock::now();
+        for (const pair<int, int>& p : pairs) {
+            TransactionResult result = executeOverlap(p.first, p.second, courses.data(), &bitmap);
+            checksum += result.both + result.either;
+        }
+        report(string("bitmap ") + kernel, chrono::steady_clock::now() - start, pairCount, checksum);
+    }
+    cout << endl << "bitmap memory: " << bitmap.memoryBytes() / 1024 << " KiB" << endl;
+    return 0;
+}
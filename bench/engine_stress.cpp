@@ -0,0 +1,95 @@
+// Engine stress test
+// Description: Pushes random REGISTER/CANCEL traffic over many courses through RegistrationEngine with
+// 1, 2, 4, ... threads, reports throughput, and checks that no course is ever overbooked and that
+// rosters, waitlists and student schedules still agree.
+// Build: g++ -std=c++17 -O2 -pthread -Isrc bench/engine_stress.cpp $(ls src/*.cpp | grep -v main.cpp) -o engine_stress
+// Usage: ./engine_stress [courses] [students] [transactions]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "batch.h"
+#include "course_index.h"
+#include "engine.h"
+#include "student_registry.h"
+
+using namespace std;
+
+// Precondition: `students` holds every student that appears in `courses`.
+// Postcondition: Returns the number of invariant violations found, printing the first few.
+static int checkInvariants(const vector<Course>& courses, const vector<Student*>& students) {
+    vector<int> enrolled(courses.size(), 0), waiting(courses.size(), 0);
+    for (const Student* student : students) {
+        for (const ScheduleEntry& entry : student->getSchedule()) {
+            if (entry.status == EnrollStatus::ENROLLED) enrolled[entry.courseId]++;
+            if (entry.status == EnrollStatus::WAIT) waiting[entry.courseId]++;
+            if (courses[entry.courseId].findStudent(student) != entry.status) enrolled[entry.courseId] = -1000000;
+        }
+    }
+    int violations = 0;
+    for (size_t i = 0; i < courses.size(); i++) {
+        const Course& course = courses[i];
+        bool ok = course.getEnrollSize() <= MAX_ENROLLED
+                  && (course.getWaitSize() == 0 || course.getEnrollSize() == MAX_ENROLLED)
+                  && enrolled[i] == course.getEnrollSize() && waiting[i] == course.getWaitSize();
+        if (!ok && violations++ < 5)
+            cout << "  violation in " << course.getCode() << ": enrolled " << course.getEnrollSize()
+                 << " (schedules say " << enrolled[i] << "), waiting " << course.getWaitSize()
+                 << " (schedules say " << waiting[i] << ")" << endl;
+    }
+    return violations;
+}
+
+int main(int argc, char* argv[]) {
+    int courseCount = argc > 1 ? atoi(argv[1]) : 4096;
+    int studentCount = argc > 2 ? atoi(argv[2]) : 100000;
+    int transactionCount = argc > 3 ? atoi(argv[3]) : 2000000;
+    int maxThreads = max(4, static_cast<int>(thread::hardware_concurrency()));
+
+    mt19937 rng(7);
+    vector<Transaction> transactions(transactionCount);
+    for (Transaction& transaction : transactions) {
+        int student = static_cast<int>(rng() % studentCount);
+        transaction.op = rng() % 3 == 0 ? Operation::CANCEL : Operation::REGISTER;
+        transaction.studentId = student;
+        transaction.name = "S" + to_string(student);
+        transaction.code = "C" + to_string(rng() % courseCount);
+    }
+
+    cout << courseCount << " courses, " << studentCount << " students, " << transactionCount
+         << " transactions, " << thread::hardware_concurrency() << " hardware threads" << endl;
+    cout << left << setw(10) << "threads" << right << setw(14) << "ops/sec" << setw(10) << "speedup"
+         << setw(12) << "violations" << endl;
+    double baseline = 0;
+    int failures = 0;
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        vector<Course> courses;
+        for (int i = 0; i < courseCount; i++)
+            courses.emplace_back(i, "C" + to_string(i), "Title" + to_string(i), 0, 0);
+        CourseIndex index(courses.data(), courseCount);
+        StudentRegistry registry;
+        vector<Student*> students;
+        for (int i = 0; i < studentCount; i++)
+            students.push_back(registry.findOrAdd(i, "S" + to_string(i)));
+
+        RegistrationEngine engine(courses.data(), index, registry, threads);
+        vector<TransactionResult> results;
+        vector<uint32_t> latencies;
+        auto start = chrono::steady_clock::now();
+        engine.executeAll(transactions, results, latencies);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        double rate = transactionCount / seconds;
+        if (threads == 1) baseline = rate;
+        int violations = checkInvariants(courses, students);
+        failures += violations;
+        cout << left << setw(10) << threads << right << setw(14) << fixed << setprecision(0) << rate
+             << setw(10) << setprecision(2) << rate / baseline << setw(12) << violations << endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
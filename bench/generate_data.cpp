@@ -0,0 +1,151 @@
+// Synthetic data generator
+// Description: Writes a course catalog and an enrollment file in the same format as data/courses.txt and
+// data/enrollment.txt, at any size, with popular courses picked more often (Zipf skew).
+// Build: g++ -std=c++17 -O2 -pthread -Isrc bench/generate_data.cpp $(ls src/*.cpp | grep -v main.cpp) -o generate_data
+// Usage: ./generate_data <course file> <enrollment file> [--courses n] [--students n]
+//                        [--per-student n] [--skew s] [--seed n]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "batch.h"
+#include "course_registration.h"
+
+using namespace std;
+
+struct GeneratorOptions {
+    int courses = 1000;
+    int students = 20000;
+    int perStudent = 4;         // each student picks 1..perStudent courses
+    double skew = 1.0;          // Zipf exponent; 0 picks courses uniformly
+    unsigned seed = 1;
+};
+
+// Precondition: `rank` >= 0.
+// Postcondition: Returns the code of the course at `rank`, e.g. "CS00042".
+static string courseCode(int rank) {
+    char code[16];
+    snprintf(code, sizeof(code), "CS%05d", rank);
+    return code;
+}
+
+// Picks course ranks with probability proportional to 1 / (rank + 1)^skew.
+class ZipfPicker {
+private:
+    vector<double> cumulative;
+public:
+    ZipfPicker(int count, double skew) : cumulative(count) {
+        double total = 0;
+        for (int rank = 0; rank < count; rank++) {
+            total += 1.0 / pow(rank + 1.0, skew);
+            cumulative[rank] = total;
+        }
+        for (double& value : cumulative)
+            value /= total;
+    }
+    int pick(mt19937_64& rng) const {
+        double point = uniform_real_distribution<double>(0.0, 1.0)(rng);
+        int rank = static_cast<int>(lower_bound(cumulative.begin(), cumulative.end(), point) - cumulative.begin());
+        return min(rank, static_cast<int>(cumulative.size()) - 1);
+    }
+};
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Usage: " << argv[0] << " <course file> <enrollment file> [--courses n] [--students n]"
+             << " [--per-student n] [--skew s] [--seed n]" << endl;
+        return 1;
+    }
+    GeneratorOptions options;
+    for (int i = 3; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--courses") == 0) options.courses = max(1, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "--students") == 0) options.students = max(0, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "--per-student") == 0) options.perStudent = max(1, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "--skew") == 0) options.skew = max(0.0, atof(argv[i + 1]));
+        else if (strcmp(argv[i], "--seed") == 0) options.seed = static_cast<unsigned>(atol(argv[i + 1]));
+        else {
+            cerr << "Unknown option " << argv[i] << endl;
+            return 1;
+        }
+    }
+    options.perStudent = min(options.perStudent, options.courses);
+    FILE* courseFile = fopen(argv[1], "w");
+    FILE* enrollmentFile = fopen(argv[2], "w");
+    if (courseFile == nullptr || enrollmentFile == nullptr) {
+        cout << "Output file opening failed." << endl;
+        return 1;
+    }
+
+    // The first MAX_ENROLLED students to pick a course get a seat; later ones join its waitlist,
+    // so the counts written to the course file match the enrollment file.
+    mt19937_64 rng(options.seed);
+    ZipfPicker picker(options.courses, options.skew);
+    vector<int> enrolledCount(options.courses, 0), waitCount(options.courses, 0);
+    vector<int> picked, enrolled, waiting;
+    {
+        OutputBuffer out(enrollmentFile);
+        for (int student = 0; student < options.students; student++) {
+            int wanted = 1 + static_cast<int>(rng() % options.perStudent);
+            picked.clear();
+            while (static_cast<int>(picked.size()) < wanted) {
+                int rank = picker.pick(rng);
+                if (find(picked.begin(), picked.end(), rank) == picked.end())
+                    picked.push_back(rank);
+            }
+            enrolled.clear();
+            waiting.clear();
+            for (int rank : picked) {
+                if (enrolledCount[rank] < MAX_ENROLLED) {
+                    enrolledCount[rank]++;
+                    enrolled.push_back(rank);
+                } else {
+                    waitCount[rank]++;
+                    waiting.push_back(rank);
+                }
+            }
+            // Every line needs at least the enrolled count; a student with only waitlisted courses has "0"
+            if (student > 0) out.append('\n');
+            out.append(100000 + student);
+            out.append(" Student");
+            out.append(student);
+            out.append(' ');
+            out.append(static_cast<int>(enrolled.size()));
+            for (int rank : enrolled) {
+                out.append(' ');
+                out.append(courseCode(rank));
+            }
+            if (!waiting.empty()) {
+                out.append(' ');
+                out.append(static_cast<int>(waiting.size()));
+                for (int rank : waiting) {
+                    out.append(' ');
+                    out.append(courseCode(rank));
+                }
+            }
+        }
+    }
+    {
+        OutputBuffer out(courseFile);
+        for (int rank = 0; rank < options.courses; rank++) {
+            if (rank > 0) out.append('\n');
+            out.append(courseCode(rank));
+            out.append(" Title_");
+            out.append(rank);
+            out.append(' ');
+            out.append(enrolledCount[rank]);
+            out.append(' ');
+            out.append(waitCount[rank]);
+        }
+    }
+    fclose(courseFile);
+    fclose(enrollmentFile);
+    cout << "Wrote " << options.courses << " courses and " << options.students << " students (skew "
+         << options.skew << ")." << endl;
+    return 0;
+}
@@ -0,0 +1,278 @@
+// Load-test client for --serve
+// Description: Opens several connections to a running server (Unix socket or localhost TCP) and keeps each one
+// busy with random REGISTER/CANCEL/QUERY requests for the students and courses of a data set. Each connection
+// sends `depth` requests in one write and then reads their `depth` responses, so depth 1 is one round trip
+// per request and larger depths show what pipelining buys. Reports requests/sec and per-window latency.
+// With --reports, one more connection asks for the full REPORT over and over meanwhile, to show how much
+// report rendering slows registrations down.
+// Build: g++ -std=c++17 -O2 -pthread -Isrc bench/load_client.cpp $(ls src/*.cpp | grep -v main.cpp) -o load_client
+// Usage: ./load_client (--unix <path> | --tcp <port>) <course file> <enrollment file>
+//                      [--connections n] [--depth n] [--seconds s] [--reports]
+// Example (one machine):
+//   ./registration --serve data/courses.txt data/enrollment.txt --unix /tmp/registration.sock &
+//   ./load_client --unix /tmp/registration.sock data/courses.txt data/enrollment.txt --connections 8 --depth 64
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "mapped_file.h"
+
+using namespace std;
+
+struct StudentKey {
+    int id;
+    string name;
+};
+
+// What one connection did
+struct ConnectionStats {
+    size_t requests = 0;
+    size_t errors = 0;
+    vector<double> windowMicros;
+    bool failed = false;
+};
+
+// Precondition: Exactly one of `socketPath` and `port` is set.
+// Postcondition: Returns a connected blocking socket, or -1.
+static int connectTo(const string& socketPath, int port) {
+    int fd;
+    if (!socketPath.empty()) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0)
+            return fd;
+    } else {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(port));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        int on = 1;
+        if (fd >= 0) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0)
+            return fd;
+    }
+    if (fd >= 0) close(fd);
+    return -1;
+}
+
+// Precondition: `fd` is a connected socket.
+// Postcondition: Returns true once all of `data` is written.
+static bool writeAll(int fd, const string& data) {
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t count = write(fd, data.data() + done, data.size() - done);
+        if (count <= 0) return false;
+        done += static_cast<size_t>(count);
+    }
+    return true;
+}
+
+// Precondition: The data set holds at least one student and one course.
+// Postcondition: Runs windows of `depth` pipelined requests on one connection until `deadline`.
+static void runConnection(const string& socketPath, int port, const vector<StudentKey>& students,
+                          const vector<string>& codes, int depth, chrono::steady_clock::time_point deadline,
+                          unsigned seed, ConnectionStats& stats) {
+    int fd = connectTo(socketPath, port);
+    if (fd < 0) {
+        stats.failed = true;
+        return;
+    }
+    mt19937 random(seed);
+    uniform_int_distribution<size_t> pickStudent(0, students.size() - 1);
+    uniform_int_distribution<size_t> pickCourse(0, codes.size() - 1);
+    uniform_int_distribution<int> pickOperation(0, 99);
+    string requests;
+    vector<char> buffer(1 << 16);
+    while (chrono::steady_clock::now() < deadline) {
+        // 45% REGISTER, 45% CANCEL, 10% QUERY
+        requests.clear();
+        for (int i = 0; i < depth; i++) {
+            const StudentKey& student = students[pickStudent(random)];
+            int operation = pickOperation(random);
+            requests += operation < 45 ? "REGISTER " : operation < 90 ? "CANCEL " : "QUERY ";
+            requests += to_string(student.id);
+            requests += ' ';
+            requests += student.name;
+            if (operation < 90) {
+                requests += ' ';
+                requests += codes[pickCourse(random)];
+            }
+            requests += '\n';
+        }
+        auto start = chrono::steady_clock::now();
+        if (!writeAll(fd, requests)) {
+            stats.failed = true;
+            break;
+        }
+        // Every response is one line; an error line starts with "ERROR"
+        int lines = 0;
+        bool lineStart = true;
+        while (lines < depth) {
+            ssize_t count = read(fd, buffer.data(), buffer.size());
+            if (count <= 0) {
+                stats.failed = true;
+                break;
+            }
+            for (ssize_t i = 0; i < count; i++) {
+                if (lineStart && buffer[i] == 'E')
+                    stats.errors++;
+                lineStart = buffer[i] == '\n';
+                lines += lineStart;
+            }
+        }
+        if (stats.failed) break;
+        stats.windowMicros.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+        stats.requests += static_cast<size_t>(depth);
+    }
+    close(fd);
+}
+
+// Precondition: None.
+// Postcondition: Sends REPORT and reads its answer until `deadline`; returns the number of reports received,
+// or -1 if the connection failed.
+static long runReports(const string& socketPath, int port, chrono::steady_clock::time_point deadline) {
+    int fd = connectTo(socketPath, port);
+    if (fd < 0) return -1;
+    long reports = 0;
+    string response;
+    vector<char> buffer(1 << 16);
+    while (chrono::steady_clock::now() < deadline) {
+        if (!writeAll(fd, "REPORT\n")) break;
+        // "REPORT <bytes>" and a line break, then the listing
+        response.clear();
+        size_t headerEnd = string::npos;
+        size_t expected = 0;
+        while (headerEnd == string::npos || response.size() < headerEnd + 1 + expected) {
+            ssize_t count = read(fd, buffer.data(), buffer.size());
+            if (count <= 0) {
+                close(fd);
+                return -1;
+            }
+            response.append(buffer.data(), static_cast<size_t>(count));
+            if (headerEnd == string::npos && (headerEnd = response.find('\n')) != string::npos)
+                expected = strtoul(response.c_str() + 7, nullptr, 10);
+        }
+        reports++;
+    }
+    close(fd);
+    return reports;
+}
+
+// Precondition: `sorted` is sorted and not empty.
+// Postcondition: Returns the value at quantile `q`.
+static double quantile(const vector<double>& sorted, double q) {
+    return sorted[min(sorted.size() - 1, static_cast<size_t>(q * sorted.size()))];
+}
+
+int main(int argc, char* argv[]) {
+    string socketPath;
+    int port = 0;
+    int connections = 4;
+    int depth = 32;
+    double seconds = 5;
+    bool reports = false;
+    vector<string> files;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--unix") == 0 && i + 1 < argc)
+            socketPath = argv[++i];
+        else if (strcmp(argv[i], "--tcp") == 0 && i + 1 < argc)
+            port = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--connections") == 0 && i + 1 < argc)
+            connections = max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc)
+            depth = max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+            seconds = max(0.1, atof(argv[++i]));
+        else if (strcmp(argv[i], "--reports") == 0)
+            reports = true;
+        else
+            files.push_back(argv[i]);
+    }
+    if (files.size() != 2 || socketPath.empty() == (port == 0)) {
+        cerr << "Usage: " << argv[0] << " (--unix <path> | --tcp <port>) <course file> <enrollment file>"
+             << " [--connections n] [--depth n] [--seconds s] [--reports]" << endl;
+        return 1;
+    }
+
+    // Course codes are the first field of the course file; students are the id and name of each enrollment line
+    vector<string> codes;
+    vector<StudentKey> students;
+    MappedFile courseFile(files[0]);
+    MappedFile enrollmentFile(files[1]);
+    if (!courseFile.isOpen() || !enrollmentFile.isOpen()) {
+        cerr << "Input file opening failed." << endl;
+        return 1;
+    }
+    const char* fieldBegin;
+    const char* fieldEnd;
+    LineScanner courses(courseFile.begin(), courseFile.end());
+    while (courses.nextLine()) {
+        if (courses.nextField(fieldBegin, fieldEnd))
+            codes.emplace_back(fieldBegin, fieldEnd);
+    }
+    LineScanner enrollment(enrollmentFile.begin(), enrollmentFile.end());
+    int id;
+    while (enrollment.nextLine()) {
+        if (enrollment.nextInt(id) && enrollment.nextField(fieldBegin, fieldEnd))
+            students.push_back(StudentKey{id, string(fieldBegin, fieldEnd)});
+    }
+    if (codes.empty() || students.empty()) {
+        cerr << "No data loaded." << endl;
+        return 1;
+    }
+
+    vector<ConnectionStats> stats(connections);
+    vector<thread> clients;
+    auto start = chrono::steady_clock::now();
+    auto deadline = start + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(seconds));
+    for (int i = 0; i < connections; i++)
+        clients.emplace_back(runConnection, cref(socketPath), port, cref(students), cref(codes), depth, deadline,
+                             static_cast<unsigned>(17 + i), ref(stats[i]));
+    long reportCount = 0;
+    if (reports)
+        clients.emplace_back([&]() { reportCount = runReports(socketPath, port, deadline); });
+    for (thread& client : clients)
+        client.join();
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    size_t requests = 0, errors = 0;
+    int failed = 0;
+    vector<double> windows;
+    for (const ConnectionStats& connection : stats) {
+        requests += connection.requests;
+        errors += connection.errors;
+        failed += connection.failed;
+        windows.insert(windows.end(), connection.windowMicros.begin(), connection.windowMicros.end());
+    }
+    if (windows.empty()) {
+        cerr << "No responses received; is the server running?" << endl;
+        return 1;
+    }
+    sort(windows.begin(), windows.end());
+    cout << connections << " connection(s), depth " << depth << ": " << requests << " requests in " << fixed
+         << setprecision(2) << elapsed << " s = " << setprecision(0) << requests / elapsed << " requests/sec" << endl;
+    cout << "window round trip (us): p50 " << setprecision(1) << quantile(windows, 0.5) << ", p99 "
+         << quantile(windows, 0.99) << ", max " << windows.back() << endl;
+    if (reports)
+        cout << "full REPORTs alongside: " << (reportCount < 0 ? "connection failed" : to_string(reportCount)) << endl;
+    failed += reportCount < 0;
+    cout << errors << " error response(s), " << failed << " connection(s) failed" << endl;
+    return failed == 0 && errors == 0 ? 0 : 1;
+}
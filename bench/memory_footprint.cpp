@@ -0,0 +1,136 @@
+// Memory footprint report
+// Description: Loads a pair of data files and reports bytes per student and per course for the compact
+// record layout (names, codes and titles in the shared StringArena) next to the layout it replaced
+// (a std::string per name, code and title).
+// Build: g++ -std=c++17 -O2 -pthread -Isrc bench/memory_footprint.cpp $(ls src/*.cpp | grep -v main.cpp) -o memory_footprint
+// Usage: ./memory_footprint <course file> <enrollment file>
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include "course_index.h"
+#include "course_registration.h"
+#include "student_registry.h"
+
+using namespace std;
+
+// The records as they were before the compact layout; the containers are unchanged.
+struct LegacyStudent {
+    int id;
+    string name;
+    vector<ScheduleEntry> schedule;
+    SpinLock scheduleLock;
+};
+
+struct LegacyCourse {
+    int id;
+    string code;
+    string title;
+    int enrollSize;
+    int waitSize;
+    StudentRoster enrolledList;
+    WaitList waitList;
+};
+
+// Precondition: None.
+// Postcondition: Returns the bytes malloc uses for a request of `size` bytes (glibc: 8-byte header,
+// 16-byte granularity, 32-byte minimum), or 0 for no request.
+static size_t mallocBytes(size_t size) {
+    if (size == 0) return 0;
+    return max<size_t>(32, (size + 8 + 15) & ~size_t(15));
+}
+
+// Precondition: None.
+// Postcondition: Returns the heap bytes a std::string holding `text` owns (0 while it fits the inline buffer).
+static size_t stringHeapBytes(string_view text) {
+    string probe;
+    return text.size() > probe.capacity() ? mallocBytes(text.size() + 1) : 0;
+}
+
+// Precondition: None.
+// Postcondition: Prints one row with the legacy and compact figures per record.
+static void row(const string& label, double legacy, double compact) {
+    cout << left << setw(32) << label << right << fixed << setprecision(1) << setw(12) << legacy << setw(12)
+         << compact << endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Usage: " << argv[0] << " <course file> <enrollment file>" << endl;
+        return 1;
+    }
+    size_t arenaBefore = StringArena::shared().bytesUsed();
+    vector<Course> courses = readFile1(argv[1]);
+    int courseCount = static_cast<int>(courses.size());
+    CourseIndex index(courses.data(), courseCount);
+    StudentRegistry registry;
+    readFile2(argv[2], courses.data(), index, registry);
+    int studentCount = registry.size();
+    if (courseCount == 0 || studentCount == 0) {
+        cerr << "No data loaded." << endl;
+        return 1;
+    }
+
+    // Walk every student once through the rosters and waitlists
+    unordered_set<const Student*> seen;
+    size_t nameArena = 0;
+    size_t legacyNameHeap = 0;
+    size_t scheduleHeap = 0;
+    for (const Course& course : courses) {
+        vector<Student*> members = course.getRoster().getItems();
+        vector<Student*> waiting = course.getWaitList().getStudents();
+        members.insert(members.end(), waiting.begin(), waiting.end());
+        for (const Student* student : members) {
+            if (!seen.insert(student).second) continue;
+            nameArena += student->getName().size();
+            legacyNameHeap += stringHeapBytes(student->getName());
+            scheduleHeap += mallocBytes(student->getSchedule().size() * sizeof(ScheduleEntry));
+        }
+    }
+    size_t courseArena = 0;
+    size_t legacyCourseHeap = 0;
+    size_t courseContainerHeap = 0;
+    for (const Course& course : courses) {
+        courseArena += course.getCode().size() + course.getTitle().size();
+        legacyCourseHeap += stringHeapBytes(course.getCode()) + stringHeapBytes(course.getTitle());
+        size_t enrolled = course.getRoster().size();
+        size_t waiting = course.getWaitList().size();
+        courseContainerHeap += mallocBytes(enrolled * (sizeof(int) + sizeof(Student*)))
+                               + mallocBytes(waiting * (sizeof(int64_t) + sizeof(uint64_t) + sizeof(Student*)))
+                               + waiting * mallocBytes(24);
+    }
+
+    size_t arenaUsed = StringArena::shared().bytesUsed() - arenaBefore;
+
+    // The registry node (id key + pointer) and its bucket are the same in both layouts
+    size_t registryPerStudent = mallocBytes(sizeof(void*) + sizeof(int) + sizeof(Student*)) + sizeof(void*);
+
+    double students = studentCount;
+    double courseTotal = courseCount;
+    cout << courseCount << " courses, " << studentCount << " students, " << arenaUsed << " arena bytes" << endl
+         << endl;
+    cout << left << setw(32) << "bytes per student" << right << setw(12) << "legacy" << setw(12) << "compact" << endl;
+    row("  record", sizeof(LegacyStudent), sizeof(Student));
+    row("  name storage", legacyNameHeap / students, nameArena / students);
+    row("  schedule + registry index", (scheduleHeap + registryPerStudent * students) / students,
+        (scheduleHeap + registryPerStudent * students) / students);
+    double legacyStudent = sizeof(LegacyStudent) + (legacyNameHeap + scheduleHeap) / students + registryPerStudent;
+    double compactStudent = sizeof(Student) + (nameArena + scheduleHeap) / students + registryPerStudent;
+    row("  total", legacyStudent, compactStudent);
+    cout << endl;
+    cout << left << setw(32) << "bytes per course" << right << setw(12) << "legacy" << setw(12) << "compact" << endl;
+    row("  record", sizeof(LegacyCourse), sizeof(Course));
+    row("  code + title storage", legacyCourseHeap / courseTotal, courseArena / courseTotal);
+    row("  roster + waitlist", courseContainerHeap / courseTotal, courseContainerHeap / courseTotal);
+    double legacyCourse = sizeof(LegacyCourse) + (legacyCourseHeap + courseContainerHeap) / courseTotal;
+    double compactCourse = sizeof(Course) + (courseArena + courseContainerHeap) / courseTotal;
+    row("  total", legacyCourse, compactCourse);
+    cout << endl;
+    cout << "whole data set: " << fixed << setprecision(1)
+         << (legacyStudent * students + legacyCourse * courseTotal) / 1024 << " KiB legacy, "
+         << (compactStudent * students + compactCourse * courseTotal) / 1024 << " KiB compact" << endl;
+    return 0;
+}
@@ -0,0 +1,207 @@
+// Registration benchmark suite
+// Description: Times the core paths -- readFile1, readFile2 (on every core and on one), registerStudent,
+// cancelStudent, findStudent, a registration burst for one course (one by one and grouped), getAllInfo, a full
+// writeReport dump and a cached one after a single change -- on a pair of data files (use generate_data for
+// large ones) and reports ops/sec and p50/p99.
+// Build: g++ -std=c++17 -O2 -pthread -Isrc bench/registration_bench.cpp $(ls src/*.cpp | grep -v main.cpp) -o registration_bench
+// Usage: ./registration_bench <course file> <enrollment file> [operations] [rounds]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "course_index.h"
+#include "course_registration.h"
+#include "mapped_file.h"
+#include "report.h"
+#include "student_registry.h"
+
+using namespace std;
+using benchClock = chrono::steady_clock;
+
+// Precondition: `samples` holds one duration per operation, in nanoseconds.
+// Postcondition: Prints count, ops/sec (from the summed time), p50 and p99.
+static void report(const string& label, vector<double>& samples) {
+    if (samples.empty()) return;
+    sort(samples.begin(), samples.end());
+    double total = 0;
+    for (double value : samples)
+        total += value;
+    size_t count = samples.size();
+    cout << left << setw(18) << label << right << setw(10) << count << setw(16) << fixed << setprecision(0)
+         << count / (total / 1e9) << setw(14) << setprecision(1) << samples[count / 2]
+         << setw(14) << samples[min(count - 1, count * 99 / 100)] << endl;
+}
+
+// Precondition: None.
+// Postcondition: Returns the nanoseconds elapsed since `start`.
+static double elapsedNs(benchClock::time_point start) {
+    return chrono::duration<double, nano>(benchClock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Usage: " << argv[0] << " <course file> <enrollment file> [operations] [rounds]" << endl;
+        return 1;
+    }
+    string courseFile = argv[1], enrollmentFile = argv[2];
+    int operations = argc > 3 ? atoi(argv[3]) : 200000;
+    int rounds = argc > 4 ? max(1, atoi(argv[4])) : 3;
+    mt19937 rng(11);
+
+    cout << left << setw(18) << "path" << right << setw(10) << "count" << setw(16) << "ops/sec"
+         << setw(14) << "p50 ns" << setw(14) << "p99 ns" << endl;
+
+    // Macro benchmarks: whole-file loads, one sample per round
+    vector<double> loadCourses, loadEnrollment, loadEnrollmentSerial;
+    for (int round = 0; round < rounds; round++) {
+        auto start = benchClock::now();
+        vector<Course> courses = readFile1(courseFile);
+        loadCourses.push_back(elapsedNs(start));
+        CourseIndex index(courses.data(), static_cast<int>(courses.size()));
+        StudentRegistry registry;
+        start = benchClock::now();
+        readFile2(enrollmentFile, courses.data(), index, registry);
+        loadEnrollment.push_back(elapsedNs(start));
+        // The same load on one thread, for the speedup of the chunked parser
+        vector<Course> serialCourses = readFile1(courseFile);
+        StudentRegistry serialRegistry;
+        start = benchClock::now();
+        readFile2(enrollmentFile, serialCourses.data(), index, serialRegistry, 1);
+        loadEnrollmentSerial.push_back(elapsedNs(start));
+    }
+    report("readFile1", loadCourses);
+    report("readFile2", loadEnrollment);
+    report("readFile2 x1", loadEnrollmentSerial);
+
+    // Micro benchmarks run against one loaded data set
+    StudentRegistry registry;
+    vector<Course> courses = readFile1(courseFile);
+    int courseCount = static_cast<int>(courses.size());
+    CourseIndex index(courses.data(), courseCount);
+    readFile2(enrollmentFile, courses.data(), index, registry);
+    if (courseCount == 0) return 0;
+
+    // Collect the student records by re-reading the id and name at the start of each enrollment line
+    vector<Student*> students;
+    MappedFile file(enrollmentFile);
+    LineScanner scanner(file.begin(), file.end());
+    const char* nameBegin;
+    const char* nameEnd;
+    int id;
+    while (scanner.nextLine()) {
+        if (scanner.nextInt(id) && scanner.nextField(nameBegin, nameEnd)) {
+            Student* student = registry.find(id, string(nameBegin, nameEnd));
+            if (student != nullptr) students.push_back(student);
+        }
+    }
+    // Add fresh students so registration also has records that are in no course yet
+    for (int i = 0; i < operations / 10 + 1; i++)
+        students.push_back(registry.findOrAdd(-1 - i, "Fresh" + to_string(i)));
+
+    vector<double> samples;
+    vector<pair<Student*, int>> pairs;
+    for (int i = 0; i < operations; i++)
+        pairs.emplace_back(students[rng() % students.size()], static_cast<int>(rng() % courseCount));
+
+    size_t hits = 0;
+    for (const auto& pair : pairs) {
+        auto start = benchClock::now();
+        hits += courses[pair.second].findStudent(pair.first) != EnrollStatus::NOT_FOUND;
+        samples.push_back(elapsedNs(start));
+    }
+    report("findStudent", samples);
+
+    // Register pairs that are not yet in the course, then cancel exactly those (including promotions)
+    vector<pair<Student*, int>> registered;
+    samples.clear();
+    for (const auto& pair : pairs) {
+        if (pair.first->getStatus(pair.second) != EnrollStatus::NOT_FOUND) continue;
+        auto start = benchClock::now();
+        courses[pair.second].registerStudent(pair.first);
+        samples.push_back(elapsedNs(start));
+        registered.push_back(pair);
+    }
+    report("registerStudent", samples);
+    shuffle(registered.begin(), registered.end(), rng);
+    samples.clear();
+    for (const auto& pair : registered) {
+        auto start = benchClock::now();
+        courses[pair.second].cancelStudent(pair.first);
+        samples.push_back(elapsedNs(start));
+    }
+    report("cancelStudent", samples);
+
+    // A burst of fresh students for one course, one by one and then as one registerAll group; every
+    // sample is the group's time divided by its size, and each burst is cancelled again afterwards
+    vector<Student*> burst;
+    for (int i = 0; i < operations; i++)
+        burst.push_back(registry.findOrAdd(-1500000000 + i, "Burst" + to_string(i)));
+    Course& popular = courses[rng() % courseCount];
+    samples.clear();
+    auto burstStart = benchClock::now();
+    for (Student* student : burst)
+        popular.registerStudent(student);
+    samples.assign(burst.size(), elapsedNs(burstStart) / max<size_t>(1, burst.size()));
+    report("register burst x1", samples);
+    for (Student* student : burst)
+        popular.cancelStudent(student);
+    burstStart = benchClock::now();
+    popular.registerAll(burst);
+    samples.assign(burst.size(), elapsedNs(burstStart) / max<size_t>(1, burst.size()));
+    report("registerAll burst", samples);
+    for (Student* student : burst)
+        popular.cancelStudent(student);
+
+    // getAllInfo writes to cout; send it to a discarded buffer while timing
+    ostringstream sink;
+    streambuf* saved = cout.rdbuf(sink.rdbuf());
+    samples.clear();
+    for (int i = 0; i < min(operations, courseCount); i++) {
+        auto start = benchClock::now();
+        courses[i].getAllInfo();
+        samples.push_back(elapsedNs(start));
+        if (sink.tellp() > (1 << 24)) sink.str("");
+    }
+    cout.rdbuf(saved);
+    report("getAllInfo", samples);
+
+    // The full enrollment dump, formatted on every core and written to /dev/null
+    FILE* devNull = fopen("/dev/null", "w");
+    if (devNull != nullptr) {
+        samples.clear();
+        auto start = benchClock::now();
+        writeReport(courses.data(), courseCount, ReportFormat::TEXT, devNull, max(1u, thread::hardware_concurrency()));
+        samples.push_back(elapsedNs(start));
+        report("writeReport", samples);
+
+        // The same dump through a ReportCache: the first fill renders every course, and after one
+        // registration only that course is rendered again
+        ReportCache cache(ReportFormat::TEXT);
+        samples.clear();
+        start = benchClock::now();
+        writeReport(courses.data(), courseCount, cache, devNull, max(1u, thread::hardware_concurrency()));
+        samples.push_back(elapsedNs(start));
+        report("report cold", samples);
+        samples.clear();
+        for (int round = 0; round < rounds; round++) {
+            Student* newcomer = registry.findOrAdd(-2000000000 + round, "Report" + to_string(round));
+            courses[round % courseCount].registerStudent(newcomer);
+            start = benchClock::now();
+            writeReport(courses.data(), courseCount, cache, devNull, max(1u, thread::hardware_concurrency()));
+            samples.push_back(elapsedNs(start));
+        }
+        report("report 1 changed", samples);
+        fclose(devNull);
+    }
+    cout << courseCount << " courses, " << registry.size() << " students, " << hits << " find hits" << endl;
+    return 0;
+}
@@ -0,0 +1,152 @@
+// Roster benchmark
+// Description: Compares the sorted flat StudentRoster (the Roster template keyed by student id) against the
+// sorted singly linked list it replaced, for course sizes of 100, 1k and 10k students: time per operation and
+// heap allocations per operation, counted by the replaced global operator new below.
+// Build: g++ -std=c++17 -O2 -pthread -Isrc bench/roster_bench.cpp $(ls src/*.cpp | grep -v main.cpp) -o roster_bench
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#include "course_registration.h"
+#include "student_registry.h"
+
+using namespace std;
+
+// Every heap allocation in the program passes through here while the benchmark runs
+static atomic<size_t> allocations(0);
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, memory_order_relaxed);
+    if (void* block = malloc(size == 0 ? 1 : size))
+        return block;
+    throw bad_alloc();
+}
+
+void operator delete(void* block) noexcept { free(block); }
+void operator delete(void* block, size_t) noexcept { free(block); }
+
+// The enrolled-student list as it was before Roster: one heap node per student,
+// id-ordered insert, and Student::equals (id and name) on every visited node.
+class LegacyList {
+private:
+    struct LegacyNode {
+        Student* data;
+        LegacyNode* next;
+    };
+    LegacyNode* head = nullptr;
+public:
+    ~LegacyList() {
+        while (head != nullptr) {
+            LegacyNode* temp = head;
+            head = head->next;
+            delete temp;
+        }
+    }
+    void add(Student* student) {
+        LegacyNode* newNode = new LegacyNode{student, nullptr};
+        if (head == nullptr || head->data->getId() > student->getId()) {
+            newNode->next = head;
+            head = newNode;
+            return;
+        }
+        LegacyNode* current = head;
+        while (current->next != nullptr && current->next->data->getId() < student->getId())
+            current = current->next;
+        newNode->next = current->next;
+        current->next = newNode;
+    }
+    bool remove(const Student* student) {
+        LegacyNode** link = &head;
+        while (*link != nullptr) {
+            if ((*link)->data->equals(student)) {
+                LegacyNode* temp = *link;
+                *link = temp->next;
+                delete temp;
+                return true;
+            }
+            link = &(*link)->next;
+        }
+        return false;
+    }
+    bool find(const Student* student) const {
+        for (LegacyNode* current = head; current != nullptr; current = current->next) {
+            if (current->data->equals(student))
+                return true;
+        }
+        return false;
+    }
+};
+
+struct Timings {
+    double buildNs;
+    double findNs;
+    double churnNs;
+    double allocationsPerOp;    // heap allocations per add, find and cancel+add together
+};
+
+// Precondition: `students` holds distinct registry records.
+// Postcondition: Returns the mean time per operation for building the roster in arrival order,
+// finding every student, and cancelling then re-registering every student.
+template <typename List>
+Timings run(const vector<Student*>& students, const vector<Student*>& churnOrder, int rounds) {
+    using clock = chrono::steady_clock;
+    double build = 0, find = 0, churn = 0;
+    size_t found = 0;
+    size_t allocationsBefore = allocations.load();
+    for (int round = 0; round < rounds; round++) {
+        List list;
+        auto t0 = clock::now();
+        for (Student* student : students)
+            list.add(student);
+        auto t1 = clock::now();
+        for (Student* student : churnOrder)
+            found += list.find(student);
+        auto t2 = clock::now();
+        for (Student* student : churnOrder) {
+            list.remove(student);
+            list.add(student);
+        }
+        auto t3 = clock::now();
+        build += chrono::duration<double, nano>(t1 - t0).count();
+        find += chrono::duration<double, nano>(t2 - t1).count();
+        churn += chrono::duration<double, nano>(t3 - t2).count();
+    }
+    if (found != students.size() * rounds)
+        cout << "warning: lookups missed students" << endl;
+    double ops = static_cast<double>(students.size()) * rounds;
+    return Timings{build / ops, find / ops, churn / ops, (allocations.load() - allocationsBefore) / ops};
+}
+
+int main() {
+    mt19937 rng(42);
+    cout << left << setw(10) << "students" << setw(12) << "structure"
+         << right << setw(14) << "add ns/op" << setw(14) << "find ns/op" << setw(18) << "cancel+add ns/op"
+         << setw(12) << "allocs/op" << endl;
+    for (int count : {100, 1000, 10000}) {
+        StudentRegistry registry;
+        vector<Student*> students;
+        for (int i = 0; i < count; i++)
+            students.push_back(registry.findOrAdd(100000 + i * 7, "Student" + to_string(i)));
+        shuffle(students.begin(), students.end(), rng);
+        vector<Student*> churnOrder = students;
+        shuffle(churnOrder.begin(), churnOrder.end(), rng);
+        int rounds = max(1, 200000 / count / (count >= 10000 ? 10 : 1));
+        Timings legacy = run<LegacyList>(students, churnOrder, rounds);
+        Timings roster = run<StudentRoster>(students, churnOrder, rounds);
+        cout << fixed << setprecision(1);
+        cout << left << setw(10) << count << setw(12) << "linked" << right << setw(14) << legacy.buildNs
+             << setw(14) << legacy.findNs << setw(18) << legacy.churnNs << setw(12) << setprecision(3)
+             << legacy.allocationsPerOp << setprecision(1) << endl;
+        cout << left << setw(10) << count << setw(12) << "Roster" << right << setw(14) << roster.buildNs
+             << setw(14) << roster.findNs << setw(18) << roster.churnNs << setw(12) << setprecision(3)
+             << roster.allocationsPerOp << setprecision(1) << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,450 @@
+// Columnar enrollment analytics: placements materialized as flat arrays and aggregated by parallel scans.
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include "analytics.h"
+#include "course_index.h"
+#include "mapped_file.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ANALYTICS_X86 1
+#endif
+
+using namespace std;
+
+// Status kernels: each returns how many of `count` status bytes are WAITLISTED (every byte is 0 or 1).
+typedef size_t (*CountKernel)(const uint8_t* flags, size_t count);
+
+// Eight flags per step: read as one word, their set bits are their sum.
+static size_t countScalar(const uint8_t* flags, size_t count) {
+    size_t total = 0;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint64_t word;
+        memcpy(&word, flags + i, sizeof(word));
+        total += __builtin_popcountll(word);
+    }
+    for (; i < count; i++)
+        total += flags[i];
+    return total;
+}
+
+#ifdef ANALYTICS_X86
+// Thirty-two flags per step, summed per 64-bit lane with PSADBW.
+__attribute__((target("avx2")))
+static size_t countAvx2(const uint8_t* flags, size_t count) {
+    __m256i sums = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(flags + i));
+        sums = _mm256_add_epi64(sums, _mm256_sad_epu8(v, _mm256_setzero_si256()));
+    }
+    size_t total = static_cast<size_t>(_mm256_extract_epi64(sums, 0)) + static_cast<size_t>(_mm256_extract_epi64(sums, 1))
+                   + static_cast<size_t>(_mm256_extract_epi64(sums, 2)) + static_cast<size_t>(_mm256_extract_epi64(sums, 3));
+    return total + countScalar(flags + i, count - i);
+}
+#endif
+
+struct StatusKernel {
+    const char* name;
+    CountKernel countWaitlisted;
+};
+
+// Precondition: None.
+// Postcondition: Returns the widest kernel this CPU can run.
+static StatusKernel detectKernel() {
+#ifdef ANALYTICS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return StatusKernel{"avx2", countAvx2};
+#endif
+    return StatusKernel{"scalar", countScalar};
+}
+
+static const StatusKernel kernel = detectKernel();
+
+// Precondition: `threadCount` >= 1.
+// Postcondition: Has run work(worker) once for every worker in [0, threadCount); this thread is worker 0.
+static void runOnThreads(int threadCount, const function<void(int)>& work) {
+    vector<thread> workers;
+    for (int worker = 1; worker < threadCount; worker++)
+        workers.emplace_back(work, worker);
+    work(0);
+    for (thread& worker : workers)
+        worker.join();
+}
+
+// Precondition: 0 <= `worker` <= `workerCount`.
+// Postcondition: Returns where `worker`'s share of [0, count) begins; worker `workerCount` gives `count`.
+static size_t shareBegin(size_t count, int worker, int workerCount) {
+    return count * worker / workerCount;
+}
+
+// Precondition: `courseStart` holds `courseCount` + 1 row offsets; 0 <= `worker` <= `workerCount`.
+// Postcondition: Returns the first course of `worker`'s share when the courses are split into runs of about
+// the same number of rows; worker `workerCount` gives `courseCount`.
+static int courseShareBegin(const vector<uint32_t>& courseStart, int courseCount, int worker, int workerCount) {
+    if (worker == workerCount)
+        return courseCount;
+    size_t row = shareBegin(courseStart[courseCount], worker, workerCount);
+    return static_cast<int>(lower_bound(courseStart.begin(), courseStart.begin() + courseCount, row)
+                            - courseStart.begin());
+}
+
+// Precondition: None.
+// Postcondition: Returns the student's address scrambled; the high half picks a shard, the low bits a slot.
+static uint64_t mixAddress(const Student* student) {
+    return (reinterpret_cast<uintptr_t>(student) >> 3) * 0x9E3779B97F4A7C15ull;
+}
+
+// Precondition: `shardCount` >= 1.
+// Postcondition: Returns which of `shardCount` shards numbers `student`.
+static int shardOf(const Student* student, int shardCount) {
+    return static_cast<int>(((mixAddress(student) >> 32) * static_cast<uint64_t>(shardCount)) >> 32);
+}
+
+// Open-addressing map from student record to dense number, sized once for its most students.
+class StudentNumbers {
+private:
+    struct Slot {
+        const Student* student;     // nullptr marks an empty slot
+        int32_t number;
+    };
+    vector<Slot> slots;
+    size_t mask;
+    int32_t count;
+public:
+    // Constructor
+    // Precondition: None.
+    // Postcondition: Creates an empty map with room for `maxStudents` students at half load.
+    StudentNumbers(size_t maxStudents) : mask(0), count(0) {
+        size_t capacity = 8;
+        while (capacity < maxStudents * 2)
+            capacity *= 2;
+        slots.assign(capacity, Slot{nullptr, 0});
+        mask = capacity - 1;
+    }
+
+    // Member function
+    // Precondition: Fewer than `maxStudents` other students were numbered before.
+    // Postcondition: Returns the student's number, giving it the next one if it had none.
+    int32_t numberOf(const Student* student) {
+        size_t pos = mixAddress(student) & mask;
+        while (slots[pos].student != nullptr) {
+            if (slots[pos].student == student)
+                return slots[pos].number;
+            pos = (pos + 1) & mask;
+        }
+        slots[pos] = Slot{student, count};
+        return count++;
+    }
+
+    // Getter
+    // Precondition: None.
+    // Postcondition: Returns how many students have a number.
+    int32_t size() const { return count; }
+};
+
+// Precondition: `courseList` points to `courseCount` valid Course objects and no transaction is running;
+// `studentCount` is the number of students in the registry. `threadCount` >= 1.
+// Postcondition: `columns` holds one row per enrolled and waitlisted student of every course: the roster in
+// id order, then the waitlist in promotion order with its positions. Students are numbered in shards by
+// address on `threadCount` threads, so no thread waits on a shared table.
+void columnsFromCourses(const Course* courseList, int courseCount, int studentCount, EnrollmentColumns& columns,
+                        int threadCount) {
+    columns.courseCount = courseCount;
+    columns.skippedLines = 0;
+    columns.courseStart.assign(courseCount + 1, 0);
+    for (int i = 0; i < courseCount; i++)
+        columns.courseStart[i + 1] = columns.courseStart[i] + courseList[i].getRoster().size()
+                                     + courseList[i].getWaitList().size();
+    size_t rowCount = columns.courseStart[courseCount];
+    columns.courseId.resize(rowCount);
+    columns.studentId.resize(rowCount);
+    columns.student.resize(rowCount);
+    columns.status.resize(rowCount);
+    columns.position.resize(rowCount);
+    vector<const Student*> members(rowCount);
+
+    // Each worker copies a run of courses whose rows are about one share of the table
+    runOnThreads(threadCount, [&](int worker) {
+        const uint32_t* start = columns.courseStart.data();
+        int first = courseShareBegin(columns.courseStart, courseCount, worker, threadCount);
+        int last = courseShareBegin(columns.courseStart, courseCount, worker + 1, threadCount);
+        vector<WaitList::Entry> waiting;
+        for (int course = first; course < last; course++) {
+            size_t row = start[course];
+            for (const Student* student : courseList[course].getRoster().getItems()) {
+                members[row] = student;
+                columns.status[row] = EnrollmentColumns::ENROLLED;
+                columns.position[row++] = 0;
+            }
+            waiting = courseList[course].getWaitList().getEntries();
+            sort(waiting.begin(), waiting.end(), WaitList::before);
+            for (size_t i = 0; i < waiting.size(); i++) {
+                members[row] = waiting[i].student;
+                columns.status[row] = EnrollmentColumns::WAITLISTED;
+                columns.position[row++] = static_cast<int32_t>(i) + 1;
+            }
+            fill(columns.courseId.begin() + start[course], columns.courseId.begin() + row, course);
+        }
+    });
+
+    // Number the students: each worker numbers the students of its own shard, then adds the shard's offset
+    vector<int> shardSizes(threadCount + 1, 0);
+    runOnThreads(threadCount, [&](int worker) {
+        size_t shardRows = 0;
+        for (size_t row = 0; row < rowCount; row++)
+            shardRows += shardOf(members[row], threadCount) == worker;
+        StudentNumbers numbers(min(shardRows, static_cast<size_t>(studentCount)));
+        for (size_t row = 0; row < rowCount; row++) {
+            if (shardOf(members[row], threadCount) != worker)
+                continue;
+            columns.student[row] = numbers.numberOf(members[row]);
+            columns.studentId[row] = members[row]->getId();
+        }
+        shardSizes[worker + 1] = numbers.size();
+    });
+    for (int shard = 0; shard < threadCount; shard++)
+        shardSizes[shard + 1] += shardSizes[shard];
+    runOnThreads(threadCount, [&](int worker) {
+        for (size_t row = shareBegin(rowCount, worker, threadCount); row < shareBegin(rowCount, worker + 1, threadCount); row++)
+            columns.student[row] += shardSizes[shardOf(members[row], threadCount)];
+    });
+    columns.studentCount = max(studentCount, shardSizes[threadCount]);
+}
+
+// Precondition: `index` was built from the course list of the term. `threadCount` >= 1.
+// Postcondition: Returns false if the file cannot be read. Otherwise `columns` holds one row per enrolled and
+// waitlisted course of every well-formed line, grouped by course and in file order within a course, with
+// waitlist positions in file order. Each line is one student, as the loader and generate_data write them.
+// The file is parsed in chunks on `threadCount` threads; each chunk then counts its rows per course, the
+// counts give every chunk its own run of rows inside each course, and the chunks fill their runs at once.
+bool columnsFromFile(const string& filename, const CourseIndex& index, EnrollmentColumns& columns, int threadCount) {
+    MappedFile file(filename);
+    if (!file.isOpen())
+        return false;
+    vector<EnrollmentChunk> chunks = parseEnrollmentFile(file.begin(), file.end(), index, threadCount);
+    int chunkCount = static_cast<int>(chunks.size());
+    int courseCount = index.size();
+
+    // rowsAt[k][c] and waitsAt[k][c]: chunk k's rows of course c, then where they start
+    vector<vector<uint32_t>> rowsAt(chunkCount, vector<uint32_t>(courseCount, 0));
+    vector<vector<uint32_t>> waitsAt(chunkCount, vector<uint32_t>(courseCount, 0));
+    runOnThreads(chunkCount, [&](int chunk) {
+        for (const Placement& placement : chunks[chunk].placements) {
+            rowsAt[chunk][placement.courseId]++;
+            waitsAt[chunk][placement.courseId] += placement.waitlisted;
+        }
+    });
+    columns.courseCount = courseCount;
+    columns.courseStart.assign(courseCount + 1, 0);
+    uint32_t row = 0;
+    for (int course = 0; course < courseCount; course++) {
+        columns.courseStart[course] = row;
+        uint32_t waiting = 0;
+        for (int chunk = 0; chunk < chunkCount; chunk++) {
+            uint32_t rows = rowsAt[chunk][course];
+            rowsAt[chunk][course] = row;
+            row += rows;
+            uint32_t waits = waitsAt[chunk][course];
+            waitsAt[chunk][course] = waiting;
+            waiting += waits;
+        }
+    }
+    columns.courseStart[courseCount] = row;
+    columns.courseId.resize(row);
+    columns.studentId.resize(row);
+    columns.student.resize(row);
+    columns.status.resize(row);
+    columns.position.resize(row);
+
+    vector<int32_t> firstStudent(chunkCount + 1, 0);
+    columns.skippedLines = 0;
+    for (int chunk = 0; chunk < chunkCount; chunk++) {
+        firstStudent[chunk + 1] = firstStudent[chunk] + static_cast<int32_t>(chunks[chunk].lines.size());
+        columns.skippedLines += static_cast<int>(chunks[chunk].badLines.size());
+    }
+    columns.studentCount = firstStudent[chunkCount];
+
+    runOnThreads(chunkCount, [&](int chunk) {
+        const EnrollmentChunk& parsed = chunks[chunk];
+        vector<uint32_t>& next = rowsAt[chunk];
+        vector<uint32_t>& waited = waitsAt[chunk];
+        uint32_t placement = 0;
+        for (size_t line = 0; line < parsed.lines.size(); line++) {
+            for (; placement < parsed.lines[line].placementEnd; placement++) {
+                int course = parsed.placements[placement].courseId;
+                bool waitlisted = parsed.placements[placement].waitlisted;
+                uint32_t at = next[course]++;
+                columns.courseId[at] = course;
+                columns.studentId[at] = parsed.lines[line].id;
+                columns.student[at] = firstStudent[chunk] + static_cast<int32_t>(line);
+                columns.status[at] = waitlisted ? EnrollmentColumns::WAITLISTED : EnrollmentColumns::ENROLLED;
+                columns.position[at] = waitlisted ? static_cast<int32_t>(++waited[course]) : 0;
+            }
+        }
+    });
+    return true;
+}
+
+// Precondition: `columns` was filled by columnsFromCourses() or columnsFromFile(). `threadCount` >= 1.
+// Postcondition: Returns the per-course counts, the per-student distributions and the `topCount` courses
+// with the most demand beyond their MAX_ENROLLED seats. Courses are split between the threads by row count
+// and their status slices are counted with the status kernel; for the distributions every thread scans
+// the whole student column and counts only its own range of student numbers, so no counter is shared.
+EnrollmentStats computeStats(const EnrollmentColumns& columns, int topCount, int threadCount) {
+    EnrollmentStats stats;
+    int courseCount = columns.courseCount;
+    size_t rowCount = columns.rows();
+    stats.enrolled.assign(courseCount, 0);
+    stats.waitlisted.assign(courseCount, 0);
+    vector<EnrollmentStats> partial(threadCount);
+    vector<int32_t> courses(columns.studentCount, 0);
+    vector<int32_t> enrolledCourses(columns.studentCount, 0);
+
+    runOnThreads(threadCount, [&](int worker) {
+        EnrollmentStats& mine = partial[worker];
+        const uint32_t* start = columns.courseStart.data();
+        int first = courseShareBegin(columns.courseStart, courseCount, worker, threadCount);
+        int last = courseShareBegin(columns.courseStart, courseCount, worker + 1, threadCount);
+        for (int course = first; course < last; course++) {
+            size_t rows = start[course + 1] - start[course];
+            int waiting = static_cast<int>(kernel.countWaitlisted(columns.status.data() + start[course], rows));
+            int seated = static_cast<int>(rows) - waiting;
+            stats.enrolled[course] = seated;
+            stats.waitlisted[course] = waiting;
+            mine.enrolledRows += seated;
+            mine.waitlistedRows += waiting;
+            mine.fullCourses += seated >= MAX_ENROLLED;
+            mine.emptyCourses += rows == 0;
+            mine.waitlistedCourses += waiting > 0;
+            mine.maxWaitlist = max(mine.maxWaitlist, waiting);
+        }
+
+        size_t low = shareBegin(columns.studentCount, worker, threadCount);
+        size_t span = shareBegin(columns.studentCount, worker + 1, threadCount) - low;
+        const int32_t* student = columns.student.data();
+        const uint8_t* status = columns.status.data();
+        for (size_t row = 0; row < rowCount; row++) {
+            size_t offset = static_cast<size_t>(student[row]) - low;
+            if (offset < span) {
+                courses[low + offset]++;
+                enrolledCourses[low + offset] += status[row] == EnrollmentColumns::ENROLLED;
+            }
+        }
+        for (size_t i = low; i < low + span; i++) {
+            if (static_cast<size_t>(courses[i]) >= mine.coursesPerStudent.size())
+                mine.coursesPerStudent.resize(courses[i] + 1, 0);
+            if (static_cast<size_t>(enrolledCourses[i]) >= mine.enrolledPerStudent.size())
+                mine.enrolledPerStudent.resize(enrolledCourses[i] + 1, 0);
+            mine.coursesPerStudent[courses[i]]++;
+            mine.enrolledPerStudent[enrolledCourses[i]]++;
+        }
+    });
+
+    for (const EnrollmentStats& mine : partial) {
+        stats.enrolledRows += mine.enrolledRows;
+        stats.waitlistedRows += mine.waitlistedRows;
+        stats.fullCourses += mine.fullCourses;
+        stats.emptyCourses += mine.emptyCourses;
+        stats.waitlistedCourses += mine.waitlistedCourses;
+        stats.maxWaitlist = max(stats.maxWaitlist, mine.maxWaitlist);
+        if (mine.coursesPerStudent.size() > stats.coursesPerStudent.size())
+            stats.coursesPerStudent.resize(mine.coursesPerStudent.size(), 0);
+        if (mine.enrolledPerStudent.size() > stats.enrolledPerStudent.size())
+            stats.enrolledPerStudent.resize(mine.enrolledPerStudent.size(), 0);
+        for (size_t k = 0; k < mine.coursesPerStudent.size(); k++)
+            stats.coursesPerStudent[k] += mine.coursesPerStudent[k];
+        for (size_t k = 0; k < mine.enrolledPerStudent.size(); k++)
+            stats.enrolledPerStudent[k] += mine.enrolledPerStudent[k];
+    }
+
+    // Demand is every student who asked for a seat; ties go to the earlier course
+    for (int course = 0; course < courseCount; course++) {
+        if (stats.enrolled[course] + stats.waitlisted[course] > MAX_ENROLLED)
+            stats.oversubscribed.push_back(course);
+    }
+    auto moreDemand = [&stats](int a, int b) {
+        int64_t demandA = int64_t(stats.enrolled[a]) + stats.waitlisted[a];
+        int64_t demandB = int64_t(stats.enrolled[b]) + stats.waitlisted[b];
+        return demandA != demandB ? demandA > demandB : a < b;
+    };
+    size_t kept = min(stats.oversubscribed.size(), static_cast<size_t>(max(0, topCount)));
+    partial_sort(stats.oversubscribed.begin(), stats.oversubscribed.begin() + kept, stats.oversubscribed.end(),
+                 moreDemand);
+    stats.oversubscribed.resize(kept);
+    return stats;
+}
+
+// Precondition: `stats` was computed from `columns`, whose course ids index `courseList`.
+// Postcondition: Writes the summary (and with `perCourse`, one tab-separated line per course) to `out`.
+// Returns false if writing failed.
+bool writeStats(const EnrollmentStats& stats, const EnrollmentColumns& columns, const Course* courseList,
+                bool perCourse, FILE* out) {
+    int courseCount = columns.courseCount;
+    int64_t seats = int64_t(courseCount) * MAX_ENROLLED;
+    double perSeat = seats > 0 ? 1.0 / seats : 0.0;
+    fprintf(out, "Enrollment analytics: %zu placements of %d students in %d courses\n",
+            columns.rows(), columns.studentCount, courseCount);
+    if (columns.skippedLines > 0)
+        fprintf(out, "Malformed enrollment lines skipped: %d\n", columns.skippedLines);
+    fprintf(out, "Fill rate: %lld of %lld seats taken (%.1f%%); %d courses full, %d empty\n",
+            static_cast<long long>(stats.enrolledRows), static_cast<long long>(seats),
+            100.0 * stats.enrolledRows * perSeat, stats.fullCourses, stats.emptyCourses);
+    fprintf(out, "Waitlist pressure: %lld students waiting for %d courses, %.2f per seat; longest waitlist %d\n",
+            static_cast<long long>(stats.waitlistedRows), stats.waitlistedCourses,
+            stats.waitlistedRows * perSeat, stats.maxWaitlist);
+
+    fprintf(out, "\nCourses per student:\n%8s %12s %12s\n", "courses", "any status", "enrolled");
+    size_t rows = max(stats.coursesPerStudent.size(), stats.enrolledPerStudent.size());
+    for (size_t k = 0; k < rows; k++) {
+        long long any = k < stats.coursesPerStudent.size() ? stats.coursesPerStudent[k] : 0;
+        long long enrolled = k < stats.enrolledPerStudent.size() ? stats.enrolledPerStudent[k] : 0;
+        fprintf(out, "%8zu %12lld %12lld\n", k, any, enrolled);
+    }
+
+    fprintf(out, "\nTop %zu oversubscribed sections (demand per seat):\n", stats.oversubscribed.size());
+    for (size_t rank = 0; rank < stats.oversubscribed.size(); rank++) {
+        const Course& course = courseList[stats.oversubscribed[rank]];
+        int enrolled = stats.enrolled[course.getId()];
+        int waitlisted = stats.waitlisted[course.getId()];
+        fprintf(out, "%4zu. %-10.*s %-24.*s enrolled %4d  waitlisted %7d  demand %.1fx\n", rank + 1,
+                static_cast<int>(course.getCode().size()), course.getCode().data(),
+                static_cast<int>(course.getTitle().size()), course.getTitle().data(), enrolled, waitlisted,
+                double(enrolled + waitlisted) / MAX_ENROLLED);
+    }
+
+    if (perCourse) {
+        fprintf(out, "\ncode\tenrolled\twaitlisted\tfill_rate\twaitlist_pressure\n");
+        for (int i = 0; i < courseCount; i++) {
+            string_view code = courseList[i].getCode();
+            fprintf(out, "%.*s\t%d\t%d\t%.3f\t%.3f\n", static_cast<int>(code.size()), code.data(),
+                    stats.enrolled[i], stats.waitlisted[i], double(stats.enrolled[i]) / MAX_ENROLLED,
+                    double(stats.waitlisted[i]) / MAX_ENROLLED);
+        }
+    }
+    fflush(out);
+    return !ferror(out);
+}
+
+// Precondition: `columns` was filled by columnsFromCourses() or columnsFromFile() in `materializeSeconds`;
+// its course ids index `courseList`. `threadCount` >= 1.
+// Postcondition: Computes the figures on `threadCount` threads and writes them to `out` as writeStats()
+// does; the time taken by each step is printed to stderr. Returns false if writing failed.
+bool runAnalytics(const EnrollmentColumns& columns, double materializeSeconds, const Course* courseList,
+                  int topCount, bool perCourse, FILE* out, int threadCount) {
+    auto start = chrono::steady_clock::now();
+    EnrollmentStats stats = computeStats(columns, topCount, threadCount);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    bool written = writeStats(stats, columns, courseList, perCourse, out);
+    cerr << "Materialized " << columns.rows() << " rows in " << fixed << setprecision(3) << materializeSeconds * 1000
+         << " ms; aggregated in " << seconds * 1000 << " ms on " << threadCount << " thread(s) with the "
+         << kernel.name << " status kernel" << endl;
+    return written;
+}
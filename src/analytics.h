@@ -0,0 +1,56 @@
+#ifndef ANALYTICS_H
+#define ANALYTICS_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "course_registration.h"
+using namespace std;
+
+// One term's enrollment stored column by column: row r is one placement of one student in one course.
+// Rows are grouped by course, so course c owns rows [courseStart[c], courseStart[c + 1]) and every
+// per-course figure is a scan of one contiguous slice. Students are numbered densely from 0, so per-student
+// figures index plain arrays instead of hashing.
+struct EnrollmentColumns {
+    static const uint8_t ENROLLED = 0;
+    static const uint8_t WAITLISTED = 1;
+
+    vector<int32_t> courseId;
+    vector<int32_t> studentId;          // the id from the files; different students may share one
+    vector<int32_t> student;            // dense student number, 0 .. studentCount - 1
+    vector<uint8_t> status;             // ENROLLED or WAITLISTED
+    vector<int32_t> position;           // 1-based place on the waitlist, 0 for enrolled rows
+    vector<uint32_t> courseStart;       // courseCount + 1 row offsets
+    int courseCount = 0;
+    int studentCount = 0;               // includes students without a row
+    int skippedLines = 0;               // malformed enrollment lines (file source only)
+
+    size_t rows() const { return courseId.size(); }
+};
+
+// Figures computed from one EnrollmentColumns.
+struct EnrollmentStats {
+    vector<int32_t> enrolled;           // per course
+    vector<int32_t> waitlisted;         // per course
+    vector<int64_t> coursesPerStudent;  // [k] = students enrolled in or waiting for k courses
+    vector<int64_t> enrolledPerStudent; // [k] = students enrolled in k courses
+    vector<int> oversubscribed;         // course ids with more demand than seats, most demand first
+    int64_t enrolledRows = 0;
+    int64_t waitlistedRows = 0;
+    int fullCourses = 0;                // at least MAX_ENROLLED enrolled
+    int emptyCourses = 0;
+    int waitlistedCourses = 0;          // at least one student waiting
+    int maxWaitlist = 0;
+};
+
+void columnsFromCourses(const Course* courseList, int courseCount, int studentCount, EnrollmentColumns& columns,
+                        int threadCount);
+bool columnsFromFile(const string& filename, const CourseIndex& index, EnrollmentColumns& columns, int threadCount);
+EnrollmentStats computeStats(const EnrollmentColumns& columns, int topCount, int threadCount);
+bool writeStats(const EnrollmentStats& stats, const EnrollmentColumns& columns, const Course* courseList,
+                bool perCourse, FILE* out);
+bool runAnalytics(const EnrollmentColumns& columns, double materializeSeconds, const Course* courseList,
+                  int topCount, bool perCourse, FILE* out, int threadCount);
+
+#endif //ANALYTICS_H
@@ -0,0 +1,343 @@
+// Non-interactive batch mode: replays REGISTER / CANCEL / QUERY records against the course data.
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "batch.h"
+#include "course_index.h"
+#include "engine.h"
+#include "enrollment_bitmap.h"
+#include "mapped_file.h"
+#include "student_registry.h"
+
+using namespace std;
+
+// OutputBuffer class
+// Constructor
+// Precondition: `out` is a stream open for writing, or nullptr to keep the text in memory.
+// Postcondition: Creates an empty buffer in front of `out`.
+OutputBuffer::OutputBuffer(FILE* out) : stream(out) {
+    if (stream != nullptr)
+        buffer.reserve(FLUSH_BYTES + 4096);
+}
+
+// Destructor
+// Precondition: None.
+// Postcondition: Any buffered output is written to the stream.
+OutputBuffer::~OutputBuffer() {
+    flush();
+}
+
+// Member function
+// Precondition: `text` points to `length` readable bytes.
+// Postcondition: The bytes are buffered; the buffer is written out once it reaches FLUSH_BYTES.
+void OutputBuffer::append(const char* text, size_t length) {
+    buffer.append(text, length);
+    if (stream != nullptr && buffer.size() >= FLUSH_BYTES)
+        flush();
+}
+
+// Precondition: None.
+// Postcondition: `text` is buffered.
+void OutputBuffer::append(string_view text) {
+    append(text.data(), text.size());
+}
+
+// Precondition: None.
+// Postcondition: `c` is buffered.
+void OutputBuffer::append(char c) {
+    buffer.push_back(c);
+    if (stream != nullptr && buffer.size() >= FLUSH_BYTES)
+        flush();
+}
+
+// Precondition: None.
+// Postcondition: The decimal form of `value` is buffered.
+void OutputBuffer::append(int value) {
+    char digits[16];
+    int length = snprintf(digits, sizeof(digits), "%d", value);
+    append(digits, static_cast<size_t>(length));
+}
+
+// Precondition: None.
+// Postcondition: All buffered bytes are written to the stream in one call and the buffer is emptied.
+void OutputBuffer::flush() {
+    if (stream == nullptr || buffer.empty()) return;
+    fwrite(buffer.data(), 1, buffer.size(), stream);
+    fflush(stream);
+    buffer.clear();
+}
+
+// Precondition: None.
+// Postcondition: The buffered text is appended to `target` and the buffer is emptied.
+void OutputBuffer::drainTo(string& target) {
+    target += buffer;
+    buffer.clear();
+}
+
+// Precondition: `scanner` is positioned on a line.
+// Postcondition: Returns true and fills `transaction` if the line is one of
+//   REGISTER <id> <name> <course code>
+//   CANCEL <id> <name> <course code>
+//   QUERY <id> <name>
+//   OVERLAP <course code> <course code>
+// otherwise returns false.
+bool parseTransaction(LineScanner& scanner, Transaction& transaction) {
+    const char* fieldBegin;
+    const char* fieldEnd;
+    if (!scanner.nextField(fieldBegin, fieldEnd)) return false;
+    string_view keyword(fieldBegin, fieldEnd - fieldBegin);
+    if (keyword == "REGISTER")
+        transaction.op = Operation::REGISTER;
+    else if (keyword == "CANCEL")
+        transaction.op = Operation::CANCEL;
+    else if (keyword == "QUERY")
+        transaction.op = Operation::QUERY;
+    else if (keyword == "OVERLAP")
+        transaction.op = Operation::OVERLAP;
+    else
+        return false;
+    if (transaction.op == Operation::OVERLAP) {
+        transaction.studentId = 0;
+        transaction.name.clear();
+        if (!scanner.nextField(fieldBegin, fieldEnd)) return false;
+        transaction.code.assign(fieldBegin, fieldEnd);
+        if (!scanner.nextField(fieldBegin, fieldEnd)) return false;
+        transaction.otherCode.assign(fieldBegin, fieldEnd);
+        return scanner.atLineEnd();
+    }
+    transaction.otherCode.clear();
+    if (!scanner.nextInt(transaction.studentId)) return false;
+    if (!scanner.nextField(fieldBegin, fieldEnd)) return false;
+    transaction.name.assign(fieldBegin, fieldEnd);
+    transaction.code.clear();
+    if (transaction.op != Operation::QUERY) {
+        if (!scanner.nextField(fieldBegin, fieldEnd)) return false;
+        transaction.code.assign(fieldBegin, fieldEnd);
+    }
+    return scanner.atLineEnd();
+}
+
+// Precondition: `courseId` is the position of `transaction.code` in `courseList`, or CourseIndex::NOT_FOUND
+// (always NOT_FOUND for QUERY). `registry` owns every student linked into `courseList`.
+// The caller serializes transactions on the same course (see RegistrationEngine).
+// Postcondition: The transaction is applied to the course data and its outcome is returned.
+TransactionResult executeTransaction(const Transaction& transaction, int courseId, Course* courseList,
+                                     StudentRegistry& registry) {
+    TransactionResult result{Outcome::NOT_REGISTERED, false, {}};
+    if (transaction.op == Operation::QUERY) {
+        const Student* student = registry.find(transaction.studentId, transaction.name);
+        result.outcome = Outcome::SCHEDULE;
+        if (student != nullptr)
+            result.schedule = student->getSchedule();
+        return result;
+    }
+    if (courseId == CourseIndex::NOT_FOUND) {
+        result.outcome = Outcome::NO_SUCH_COURSE;
+        return result;
+    }
+    Course& course = courseList[courseId];
+    if (transaction.op == Operation::REGISTER) {
+        Student* student = registry.findOrAdd(transaction.studentId, transaction.name);
+        // A student who is already in the course keeps the current standing
+        EnrollStatus status = student->getStatus(courseId);
+        if (status == EnrollStatus::NOT_FOUND) {
+            status = course.registerStudent(student) ? EnrollStatus::ENROLLED : EnrollStatus::WAIT;
+            result.changed = true;
+        }
+        result.outcome = status == EnrollStatus::ENROLLED ? Outcome::ENROLLED : Outcome::WAITLISTED;
+    } else {
+        Student* student = registry.find(transaction.studentId, transaction.name);
+        EnrollStatus status = student != nullptr ? student->getStatus(courseId) : EnrollStatus::NOT_FOUND;
+        if (status != EnrollStatus::NOT_FOUND) {
+            course.cancelStudent(student);
+            result.changed = true;
+        }
+        if (status == EnrollStatus::ENROLLED)
+            result.outcome = Outcome::DROPPED;
+        else if (status == EnrollStatus::WAIT)
+            result.outcome = Outcome::LEFT_WAITLIST;
+    }
+    return result;
+}
+
+// Precondition: The ids are positions in `courseList`, or CourseIndex::NOT_FOUND. `bitmap` is the courses'
+// EnrollmentBitmap, or nullptr to walk the rosters, in which case the caller holds both course locks.
+// Postcondition: Returns how many students are enrolled in or waiting for both courses, and for either.
+// With a bitmap the counts are vectorized row operations; without one, every member of the smaller course
+// is checked against the other course through the student's schedule.
+TransactionResult executeOverlap(int firstCourseId, int secondCourseId, const Course* courseList,
+                                 const EnrollmentBitmap* bitmap) {
+    TransactionResult result{Outcome::OVERLAP, false, {}};
+    if (firstCourseId == CourseIndex::NOT_FOUND || secondCourseId == CourseIndex::NOT_FOUND) {
+        result.outcome = Outcome::NO_SUCH_COURSE;
+        return result;
+    }
+    const Course& first = courseList[firstCourseId];
+    const Course& second = courseList[secondCourseId];
+    if (bitmap != nullptr) {
+        result.both = static_cast<int>(bitmap->intersectionCount(firstCourseId, secondCourseId));
+        result.either = static_cast<int>(bitmap->unionCount(firstCourseId, secondCourseId));
+        return result;
+    }
+    int firstSize = first.getRoster().size() + first.getWaitList().size();
+    int secondSize = second.getRoster().size() + second.getWaitList().size();
+    const Course& smaller = firstSize <= secondSize ? first : second;
+    int otherId = firstSize <= secondSize ? secondCourseId : firstCourseId;
+    for (const Student* student : smaller.getRoster().getItems())
+        result.both += student->getStatus(otherId) != EnrollStatus::NOT_FOUND;
+    for (const Student* student : smaller.getWaitList().getStudents())
+        result.both += student->getStatus(otherId) != EnrollStatus::NOT_FOUND;
+    result.either = firstSize + secondSize - result.both;
+    return result;
+}
+
+// Precondition: `result` came from executing `transaction` against `courseList`.
+// Postcondition: One result line is appended to `out`: the request fields followed by ENROLLED, WAITLISTED,
+// DROPPED, LEFT_WAITLIST, NOT_REGISTERED or NO_SUCH_COURSE, for QUERY the schedule as "R:<codes> W:<codes>",
+// and for OVERLAP the two codes followed by "BOTH:<count> EITHER:<count>" (or NO_SUCH_COURSE).
+void formatResult(const Transaction& transaction, const TransactionResult& result, const Course* courseList,
+                  OutputBuffer& out) {
+    static const char* const keywords[] = {"REGISTER ", "CANCEL ", "QUERY ", "OVERLAP "};
+    static const char* const outcomes[] = {"ENROLLED\n", "WAITLISTED\n", "DROPPED\n", "LEFT_WAITLIST\n",
+                                           "NOT_REGISTERED\n", "NO_SUCH_COURSE\n"};
+    out.append(keywords[static_cast<int>(transaction.op)]);
+    if (transaction.op == Operation::OVERLAP) {
+        out.append(transaction.code);
+        out.append(' ');
+        out.append(transaction.otherCode);
+        if (result.outcome != Outcome::OVERLAP) {
+            out.append(' ');
+            out.append(outcomes[static_cast<int>(result.outcome)]);
+            return;
+        }
+        out.append(" BOTH:");
+        out.append(result.both);
+        out.append(" EITHER:");
+        out.append(result.either);
+        out.append('\n');
+        return;
+    }
+    out.append(transaction.studentId);
+    out.append(' ');
+    out.append(transaction.name);
+    out.append(' ');
+    if (result.outcome != Outcome::SCHEDULE) {
+        out.append(transaction.code);
+        out.append(' ');
+        out.append(outcomes[static_cast<int>(result.outcome)]);
+        return;
+    }
+    for (EnrollStatus wanted : {EnrollStatus::ENROLLED, EnrollStatus::WAIT}) {
+        out.append(wanted == EnrollStatus::ENROLLED ? "R:" : " W:");
+        bool first = true;
+        for (const ScheduleEntry& entry : result.schedule) {
+            if (entry.status != wanted) continue;
+            if (!first) out.append(',');
+            out.append(courseList[entry.courseId].getCode());
+            first = false;
+        }
+    }
+    out.append('\n');
+}
+
+// Precondition: `latencies` holds the per-operation times in nanoseconds.
+// Postcondition: One summary row for the operation is printed to stderr.
+static void printLatency(const char* label, vector<uint32_t>& latencies) {
+    if (latencies.empty()) return;
+    sort(latencies.begin(), latencies.end());
+    double total = 0;
+    for (uint32_t value : latencies)
+        total += value;
+    size_t count = latencies.size();
+    cerr << left << setw(10) << label << right << setw(10) << count
+         << setw(12) << fixed << setprecision(0) << total / count
+         << setw(10) << latencies[count / 2]
+         << setw(10) << latencies[min(count - 1, count * 99 / 100)]
+         << setw(12) << latencies.back() << endl;
+}
+
+int runBatch(FILE* commands, RegistrationEngine& engine, const Course* courseList, FILE* results) {
+    // Precondition: `commands` is open for reading and holds one transaction per line (see parseTransaction).
+    // `engine` was built over `courseList`.
+
+    // Postcondition: The transactions are read in blocks, each block is applied through `engine` (on its
+    // worker threads when it has more than one), and the results are written to `results` in input order
+    // through a large buffer. Malformed lines produce an "ERROR line <n>" result and are skipped.
+    // Throughput and per-operation latency (mean, p50, p99, max) are printed to stderr; requests applied in
+    // a course group are each charged an equal share of the group's time.
+    // Returns the number of malformed lines.
+
+    using clock = chrono::steady_clock;
+    OutputBuffer out(results);
+    vector<uint32_t> latencies[4];
+    vector<char> block(1 << 20);
+    size_t pending = 0;
+    int lineBase = 0, errors = 0;
+    vector<Transaction> transactions;
+    vector<TransactionResult> outcomes;
+    vector<uint32_t> blockLatencies;
+    vector<pair<size_t, int>> badLines;     // (transactions parsed before it, line number)
+    auto start = clock::now();
+    bool done = false;
+    while (!done) {
+        if (pending == block.size())
+            block.resize(block.size() * 2);
+        size_t bytesRead = fread(block.data() + pending, 1, block.size() - pending, commands);
+        size_t filled = pending + bytesRead;
+        done = bytesRead == 0;
+        // Only hand complete lines to the scanner; a trailing partial line waits for the next read
+        size_t complete = filled;
+        if (!done) {
+            const char* last = static_cast<const char*>(memrchr(block.data(), '\n', filled));
+            if (last == nullptr) {
+                pending = filled;
+                continue;
+            }
+            complete = last - block.data() + 1;
+        }
+        LineScanner scanner(block.data(), block.data() + complete);
+        transactions.clear();
+        badLines.clear();
+        Transaction transaction;
+        while (scanner.nextLine()) {
+            if (scanner.atLineEnd()) continue;
+            if (parseTransaction(scanner, transaction))
+                transactions.push_back(transaction);
+            else
+                badLines.emplace_back(transactions.size(), lineBase + scanner.getLineNumber());
+        }
+        engine.executeAll(transactions, outcomes, blockLatencies);
+        size_t nextBad = 0;
+        for (size_t i = 0; i <= transactions.size(); i++) {
+            for (; nextBad < badLines.size() && badLines[nextBad].first == i; nextBad++) {
+                out.append("ERROR line ");
+                out.append(badLines[nextBad].second);
+                out.append(": expected REGISTER|CANCEL <id> <name> <code>, QUERY <id> <name> or OVERLAP <code> <code>\n");
+                errors++;
+            }
+            if (i == transactions.size()) break;
+            formatResult(transactions[i], outcomes[i], courseList, out);
+            latencies[static_cast<int>(transactions[i].op)].push_back(blockLatencies[i]);
+        }
+        lineBase += scanner.getLineNumber();
+        pending = filled - complete;
+        memmove(block.data(), block.data() + complete, pending);
+    }
+    out.flush();
+    double seconds = chrono::duration<double>(clock::now() - start).count();
+    size_t total = latencies[0].size() + latencies[1].size() + latencies[2].size() + latencies[3].size();
+    cerr << "Processed " << total << " operations in " << fixed << setprecision(3) << seconds * 1000 << " ms ("
+         << setprecision(0) << (seconds > 0 ? total / seconds : 0) << " ops/sec) on " << engine.getThreadCount()
+         << " thread(s), " << errors << " malformed lines" << endl;
+    cerr << left << setw(10) << "operation" << right << setw(10) << "count" << setw(12) << "mean ns"
+         << setw(10) << "p50 ns" << setw(10) << "p99 ns" << setw(12) << "max ns" << endl;
+    printLatency("REGISTER", latencies[0]);
+    printLatency("CANCEL", latencies[1]);
+    printLatency("QUERY", latencies[2]);
+    printLatency("OVERLAP", latencies[3]);
+    return errors;
+}
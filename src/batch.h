@@ -0,0 +1,65 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include "course_registration.h"
+using namespace std;
+
+// A registration request replayed from a command file.
+enum class Operation { REGISTER, CANCEL, QUERY, OVERLAP };
+
+struct Transaction {
+    Operation op;
+    int studentId;      // 0 for OVERLAP
+    string name;        // empty for OVERLAP
+    string code;        // empty for QUERY
+    string otherCode;   // OVERLAP only: the second course
+};
+
+// Collects output in a large buffer and hands it to the stream in big writes.
+// Without a stream the text just accumulates until drainTo() takes it (used for socket responses).
+class OutputBuffer {
+private:
+    FILE* stream;
+    string buffer;
+public:
+    static const size_t FLUSH_BYTES = 1 << 20;
+    OutputBuffer(FILE* out = nullptr);
+    ~OutputBuffer();
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+    void append(const char* text, size_t length);
+    void append(string_view text);
+    void append(char c);
+    void append(int value);
+    void flush();
+    void drainTo(string& target);
+};
+
+// What a transaction did, as reported on its result line.
+enum class Outcome { ENROLLED, WAITLISTED, DROPPED, LEFT_WAITLIST, NOT_REGISTERED, NO_SUCH_COURSE, SCHEDULE,
+                     OVERLAP };
+
+struct TransactionResult {
+    Outcome outcome;
+    bool changed;                       // true if the course data was modified
+    vector<ScheduleEntry> schedule;     // QUERY only: the student's schedule when the query ran
+    int both = 0;                       // OVERLAP only: students in both courses
+    int either = 0;                     // OVERLAP only: students in at least one of them
+};
+
+class LineScanner;
+class RegistrationEngine;
+
+bool parseTransaction(LineScanner& scanner, Transaction& transaction);
+TransactionResult executeTransaction(const Transaction& transaction, int courseId, Course* courseList,
+                                     StudentRegistry& registry);
+TransactionResult executeOverlap(int firstCourseId, int secondCourseId, const Course* courseList,
+                                 const EnrollmentBitmap* bitmap);
+void formatResult(const Transaction& transaction, const TransactionResult& result, const Course* courseList,
+                  OutputBuffer& out);
+int runBatch(FILE* commands, RegistrationEngine& engine, const Course* courseList, FILE* results);
+
+#endif //BATCH_H
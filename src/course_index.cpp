@@ -0,0 +1,69 @@
+// Hashed course-code index used by every course lookup path.
+
+#include "course_index.h"
+
+using namespace std;
+
+// CourseIndex class
+// Constructor
+// Precondition: None.
+// Postcondition: Creates an empty index; every find() returns NOT_FOUND.
+CourseIndex::CourseIndex() : slots(1, Slot{0, NOT_FOUND}), codeOffsets(1, 0), mask(0) {}
+
+// Precondition: `courseList` points to `courseCount` valid Course objects.
+// Postcondition: Every course code is interned and mapped to its position in `courseList`.
+// If a code appears more than once, the first course with that code wins.
+CourseIndex::CourseIndex(const Course* courseList, int courseCount) : mask(0) {
+    size_t capacity = 8;
+    while (capacity < static_cast<size_t>(courseCount) * 2)
+        capacity *= 2;
+    slots.assign(capacity, Slot{0, NOT_FOUND});
+    mask = capacity - 1;
+    codeOffsets.reserve(courseCount + 1);
+    codeOffsets.push_back(0);
+    for (int i = 0; i < courseCount; i++) {
+        string_view code = courseList[i].getCode();
+        codeChars.insert(codeChars.end(), code.begin(), code.end());
+        codeOffsets.push_back(static_cast<uint32_t>(codeChars.size()));
+    }
+    for (int i = 0; i < courseCount; i++) {
+        string_view code = codeAt(i);
+        uint32_t hash = hashString(code);
+        size_t pos = hash & mask;
+        bool duplicate = false;
+        while (slots[pos].courseId != NOT_FOUND) {
+            if (slots[pos].hash == hash && codeAt(slots[pos].courseId) == code) {
+                duplicate = true;
+                break;
+            }
+            pos = (pos + 1) & mask;
+        }
+        if (!duplicate)
+            slots[pos] = Slot{hash, i};
+    }
+}
+
+// Precondition: 0 <= `courseId` < size().
+// Postcondition: Returns the interned code of the course at `courseId`.
+string_view CourseIndex::codeAt(int courseId) const {
+    return string_view(codeChars.data() + codeOffsets[courseId], codeOffsets[courseId + 1] - codeOffsets[courseId]);
+}
+
+// Member function
+// Precondition: None.
+// Postcondition: Returns the position of the course with the given code, or NOT_FOUND.
+int CourseIndex::find(string_view code) const {
+    uint32_t hash = hashString(code);
+    size_t pos = hash & mask;
+    while (slots[pos].courseId != NOT_FOUND) {
+        if (slots[pos].hash == hash && codeAt(slots[pos].courseId) == code)
+            return slots[pos].courseId;
+        pos = (pos + 1) & mask;
+    }
+    return NOT_FOUND;
+}
+
+// Getter
+// Precondition: None.
+// Postcondition: Returns the number of courses the index was built from.
+int CourseIndex::size() const { return static_cast<int>(codeOffsets.size()) - 1; }
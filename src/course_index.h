@@ -0,0 +1,34 @@
+#ifndef COURSE_INDEX_H
+#define COURSE_INDEX_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "course_registration.h"
+#include "string_arena.h"
+using namespace std;
+
+// Open-addressing hash map from course code to the course's position in the course list.
+// Codes are interned once in a single character buffer when the index is built; a lookup
+// hashes the query, probes linearly and compares the cached hash before touching the bytes.
+class CourseIndex {
+private:
+    struct Slot {
+        uint32_t hash;
+        int courseId;       // -1 marks an empty slot
+    };
+    vector<Slot> slots;
+    vector<char> codeChars;
+    vector<uint32_t> codeOffsets;   // courseId -> offset of its code in codeChars, plus one end offset
+    size_t mask;
+    string_view codeAt(int courseId) const;
+public:
+    static const int NOT_FOUND = -1;
+    CourseIndex();
+    CourseIndex(const Course* courseList, int courseCount);
+    int find(string_view code) const;
+    int size() const;
+};
+
+#endif //COURSE_INDEX_H
@@ -1,20 +1,33 @@
 // Course Registration System
 // Author: Sherry Shi
-// Description: Implements a course registration system using linked lists and queues in C++.
+// Description: Implements a course registration system using sorted rosters and queues in C++.
 // Date: 10-11-2024
 
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <thread>
 #include "course_registration.h"
+#include "batch.h"
+#include "course_index.h"
+#include "engine.h"
+#include "enrollment_bitmap.h"
+#include "mapped_file.h"
+#include "metrics.h"
+#include "report.h"
+#include "student_registry.h"
 
 using namespace std;
 
 // Student class
 // Constructor
 // Precondition: `studentId` is a valid integer and `studentName` is a non-empty string.
-// Postcondition: A new Student object is created with the given id and name.
-Student::Student(const int& studentId, const string& studentName) : id(studentId), name(studentName) {}
+// Postcondition: A new Student object is created with the given id and name; the name is copied to the arena.
+Student::Student(int studentId, string_view studentName)
+        : id(studentId), name(StringArena::shared().store(studentName)) {}
 
 // Getter
 // Precondition: None.
@@ -22,343 +35,750 @@ Student::Student(const int& studentId, const string& studentName) : id(studentId
 int Student::getId() const { return id; }
 
 // Precondition: None.
-// Postcondition: Returns the student's name.
-string Student::getName() const { return name; }
+// Postcondition: Returns a view of the student's name, valid for the life of the program.
+string_view Student::getName() const { return StringArena::shared().view(name); }
+
+// Precondition: None.
+// Postcondition: Returns a copy of the courses this student is enrolled in or waiting for, in course list order.
+vector<ScheduleEntry> Student::getSchedule() const {
+    lock_guard<SpinLock> guard(scheduleLock);
+    return schedule;
+}
+
+// Precondition: None.
+// Postcondition: Returns the student's standing in the course at `courseId`.
+EnrollStatus Student::getStatus(int courseId) const {
+    lock_guard<SpinLock> guard(scheduleLock);
+    auto pos = lower_bound(schedule.begin(), schedule.end(), courseId,
+                           [](const ScheduleEntry& entry, int target) { return entry.courseId < target; });
+    if (pos != schedule.end() && pos->courseId == courseId)
+        return pos->status;
+    return EnrollStatus::NOT_FOUND;
+}
+
+// Setter
+// Precondition: None.
+// Postcondition: Records `status` for the course at `courseId`; NOT_FOUND removes the course from the schedule.
+void Student::setStatus(int courseId, EnrollStatus status) {
+    lock_guard<SpinLock> guard(scheduleLock);
+    auto pos = lower_bound(schedule.begin(), schedule.end(), courseId,
+                           [](const ScheduleEntry& entry, int target) { return entry.courseId < target; });
+    bool present = pos != schedule.end() && pos->courseId == courseId;
+    if (status == EnrollStatus::NOT_FOUND) {
+        if (present) schedule.erase(pos);
+    } else if (present) {
+        pos->status = status;
+    } else {
+        schedule.insert(pos, ScheduleEntry{courseId, status});
+    }
+}
+
+// Precondition: `entries` are sorted by course id, at most one per course.
+// Postcondition: The schedule is replaced by `entries`.
+void Student::setSchedule(vector<ScheduleEntry> entries) {
+    lock_guard<SpinLock> guard(scheduleLock);
+    schedule = move(entries);
+}
 
 // Member function
 // Precondition: `other` is a valid pointer to a Student object.
 // Postcondition: Returns true if the id and name of the current Student object match `other`, otherwise false.
+// The registry keeps one record per student, so a match is normally decided by the ids and the record
+// itself; names are only compared to tell apart two records that share an id.
 bool Student::equals(const Student* other) const {
-    return id == other->getId() && name == other->getName();
+    if (id != other->id) return false;
+    return this == other || getName() == other->getName();
 }
 
 // Precondition: None.
 // Postcondition: The student's id and name are printed to the console in a formatted manner.
 void Student::print() const {
-    cout << left << setw(15) << id << setw(15) << name << endl;
+    cout << left << setw(15) << id << setw(15) << getName() << endl;
 }
 
-// Node class
-// Constructor
-// Precondition: `student` is a valid pointer to a Student object.
-// Postcondition: A new Node is created with the given student as its data and `next` is set to nullptr.
-Node::Node(Student* student) : data(student), next(nullptr) {}
-
-// Getter
+// PromotionPolicy class
 // Precondition: None.
-// Postcondition: Returns the data stored in the node, which is a pointer to a Student object.
-Student* Node::getData(){return data;}
+// Postcondition: Every student has the same rank, so the waitlist is first come, first served.
+static int64_t arrivalRank(const Student*) { return 0; }
 
-// Precondition: None.
-// Postcondition: Returns the next node pointer in the linked list.
-Node* Node::getNext(){return next;}
+// Precondition: `student` is a valid pointer to a Student object.
+// Postcondition: Returns the student id; ids are issued at matriculation, so senior students rank first.
+static int64_t seniorityRank(const Student* student) { return student->getId(); }
 
-// Setter
-// Precondition: `Data` is a valid pointer to a Student object.
-// Postcondition: Sets the node's data to `Data`.
-void Node::setData(Student* Data){data = Data;}
+const PromotionPolicy PromotionPolicy::FIFO = {"fifo", arrivalRank};
+const PromotionPolicy PromotionPolicy::SENIORITY = {"seniority", seniorityRank};
 
-// Precondition: `Next` is a valid pointer to a Node object or nullptr.
-// Postcondition: Sets the node's next pointer to `Next`.
-void Node::setNext(Node* Next){next = Next;}
+// Precondition: None.
+// Postcondition: Returns the built-in policy called `name`, or nullptr if there is none.
+const PromotionPolicy* PromotionPolicy::find(const string& name) {
+    for (const PromotionPolicy* policy : {&FIFO, &SENIORITY})
+        if (name == policy->name)
+            return policy;
+    return nullptr;
+}
 
-// SingleLinkedList class
+// WaitList class
 // Constructor
 // Precondition: None.
-// Postcondition: Creates an empty SingleLinkedList object with `head` set to nullptr.
-SingleLinkedList::SingleLinkedList() : head(nullptr) {}
+// Postcondition: Creates an empty first-come, first-served waitlist.
+WaitList::WaitList() : nextTicket(0), policy(&PromotionPolicy::FIFO) {}
 
-// Destructor
 // Precondition: None.
-// Postcondition: All nodes in the linked list are deleted, including their associated student objects.
-SingleLinkedList::~SingleLinkedList() {
-    Node* current = head;
-    while (current != nullptr) {
-        Node* temp = current;
-        current = current->getNext();
-        delete temp->getData();
-        delete temp;
+// Postcondition: Returns true if `a` is promoted before `b`.
+bool WaitList::before(const Entry& a, const Entry& b) {
+    return a.rank != b.rank ? a.rank < b.rank : a.ticket < b.ticket;
+}
+
+// Precondition: `slot` < heap.size().
+// Postcondition: The entry at `slot` has moved up until its parent goes before it; `slots` follows every move.
+void WaitList::siftUp(size_t slot) {
+    Entry entry = heap[slot];
+    while (slot > 0) {
+        size_t parent = (slot - 1) / 2;
+        if (!before(entry, heap[parent])) break;
+        heap[slot] = heap[parent];
+        slots[heap[slot].student] = slot;
+        slot = parent;
+    }
+    heap[slot] = entry;
+    slots[entry.student] = slot;
+}
+
+// Precondition: `slot` < heap.size().
+// Postcondition: The entry at `slot` has moved down until it goes before both children; `slots` follows every move.
+void WaitList::siftDown(size_t slot) {
+    Entry entry = heap[slot];
+    for (;;) {
+        size_t child = 2 * slot + 1;
+        if (child >= heap.size()) break;
+        if (child + 1 < heap.size() && before(heap[child + 1], heap[child]))
+            child++;
+        if (!before(heap[child], entry)) break;
+        heap[slot] = heap[child];
+        slots[heap[slot].student] = slot;
+        slot = child;
     }
+    heap[slot] = entry;
+    slots[entry.student] = slot;
 }
 
 // Member function
+// Precondition: `student` is a valid pointer to a Student object owned by the StudentRegistry.
+// Postcondition: Adds the student with the next arrival ticket and returns true,
+// or returns false if the student is already waiting.
+bool WaitList::enqueue(Student* student) {
+    if (slots.count(student) > 0) return false;
+    heap.push_back(Entry{policy->rank(student), nextTicket++, student});
+    order.insert({heap.back().rank, heap.back().ticket});
+    siftUp(heap.size() - 1);
+    return true;
+}
+
+// Precondition: None.
+// Postcondition: Removes and returns the student the policy promotes next. If the queue is empty, returns nullptr.
+Student* WaitList::dequeue() {
+    if (heap.empty()) return nullptr;
+    Student* student = heap.front().student;
+    slots.erase(student);
+    order.erase({heap.front().rank, heap.front().ticket});
+    heap.front() = heap.back();
+    heap.pop_back();
+    if (!heap.empty())
+        siftDown(0);
+    return student;
+}
+
 // Precondition: `student` is a valid pointer to a Student object.
-// Postcondition: The student is added to the list in ascending order by id. The list is still sorted after insertion.
-void SingleLinkedList::add(Student* student) {
-    Node* newNode = new Node(student);
-    // For the first position
-    if (head == nullptr || head->getData()->getId() > student->getId()) {
-        newNode->setNext(head);
-        head = newNode;
-    }
-    // For other positions
-    else {
-        Node* current = head;
-        while (current->getNext() != nullptr && current->getNext()->getData()->getId() < student->getId()) {
-            current = current->getNext();
-        }
-        newNode->setNext(current->getNext());
-        current->setNext(newNode);
+// Postcondition: Removes the student from the queue and returns true, or returns false if the student is not waiting.
+// The other students keep their order.
+bool WaitList::remove(const Student* student) {
+    auto it = slots.find(student);
+    if (it == slots.end()) return false;
+    size_t slot = it->second;
+    slots.erase(it);
+    order.erase({heap[slot].rank, heap[slot].ticket});
+    Entry last = heap.back();
+    heap.pop_back();
+    if (slot < heap.size()) {
+        // The last entry fills the gap and moves whichever way restores the heap
+        bool up = slot > 0 && before(last, heap[(slot - 1) / 2]);
+        heap[slot] = last;
+        if (up)
+            siftUp(slot);
+        else
+            siftDown(slot);
     }
+    return true;
 }
 
 // Precondition: `student` is a valid pointer to a Student object.
-// Postcondition: Removes the node containing the student from the list.
-// Returns true if the student was found and removed, otherwise false.
-bool SingleLinkedList::remove(Student* student) {
-    // Check if the list is empty
-    if (head == nullptr) return false;
-    // Find the target student and then remove
-    // For the first position
-    if (head->getData()->equals(student)) {
-        Node* temp = head;
-        head = head->getNext();
-        delete temp;
-        return true;
-    }
-    // For other positions
-    Node* current = head;
-    while (current->getNext() != nullptr) {
-        if (current->getNext()->getData()->equals(student)) {
-            Node* temp = current->getNext();
-            current->setNext(current->getNext()->getNext());
-            delete temp;
-            return true;
-        }
-        current = current->getNext();
-    }
-    return false;
+// Postcondition: Returns true if the student is waiting, otherwise false.
+bool WaitList::find(const Student* student) const {
+    return slots.count(student) > 0;
 }
 
+// Precondition: `student` is a valid pointer to a Student object.
+// Postcondition: Returns the student's 1-based place in promotion order, or 0 if the student is not waiting.
+// The order-statistic tree counts the entries ahead in O(log n).
+int WaitList::position(const Student* student) const {
+    auto it = slots.find(student);
+    if (it == slots.end()) return 0;
+    const Entry& entry = heap[it->second];
+    return order.countLess({entry.rank, entry.ticket}) + 1;
+}
+
+// Getter
+// Precondition: None.
+// Postcondition: Returns the number of students waiting.
+int WaitList::size() const { return static_cast<int>(heap.size()); }
+
+// Member function
 // Precondition: None.
-// Postcondition: Removes and returns the first student in the list. If the list is empty, returns nullptr.
-Student* SingleLinkedList::removeFirst() {
-    if (head == nullptr) return nullptr;
-    Node* temp = head;
-    Student* student = head->getData();
-    head = head->getNext();
-    delete temp;
-    return student;
+// Postcondition: The queue has room for `count` students without growing or rehashing.
+void WaitList::reserve(int count) {
+    heap.reserve(count);
+    slots.reserve(count);
+    order.reserve(count);
 }
 
-// Precondition: `student` is a valid pointer to a Student object.
-// Postcondition: Returns true if the student is found in the list, otherwise false.
-bool SingleLinkedList::find(Student* student) const {
-    Node* current = head;
-    while (current != nullptr) {
-        if (current->getData()->equals(student)) {
-            return true;
-        }
-        current = current->getNext();
+// Precondition: The waitlist is empty. `entries` hold distinct students and distinct tickets.
+// Postcondition: The waitlist holds the entries, ranked under the current policy, as if each student had
+// arrived with its ticket. Entries already in promotion order (as a saved waitlist is) form a valid heap as
+// they are, so the heap and the order tree are built in one pass.
+void WaitList::assign(vector<Entry> entries) {
+    for (Entry& entry : entries)
+        entry.rank = policy->rank(entry.student);
+    if (!is_sorted(entries.begin(), entries.end(), before))
+        sort(entries.begin(), entries.end(), before);
+    heap = move(entries);
+    slots.reserve(heap.size());
+    vector<pair<int64_t, uint64_t>> keys;
+    keys.reserve(heap.size());
+    for (size_t slot = 0; slot < heap.size(); slot++) {
+        slots.emplace(heap[slot].student, slot);
+        keys.push_back({heap[slot].rank, heap[slot].ticket});
+        nextTicket = max(nextTicket, heap[slot].ticket + 1);
     }
-    return false;
+    order.assign(keys);
 }
 
 // Precondition: None.
-// Postcondition: Prints all students in the list to the console in a formatted manner.
-void SingleLinkedList::printList() const {
-    Node* current = head;
-    while (current != nullptr) {
-        current->getData()->print();
-        current = current->getNext();
+// Postcondition: Returns the waiting students in promotion order.
+vector<Student*> WaitList::getStudents() const {
+    vector<Entry> ordered(heap);
+    sort(ordered.begin(), ordered.end(), before);
+    vector<Student*> waiting;
+    waiting.reserve(ordered.size());
+    for (const Entry& entry : ordered)
+        waiting.push_back(entry.student);
+    return waiting;
+}
+
+// Precondition: None.
+// Postcondition: Returns the entries in heap order; sorting a copy with before() gives promotion order.
+const vector<WaitList::Entry>& WaitList::getEntries() const { return heap; }
+
+// Member function
+// Precondition: None.
+// Postcondition: Prints all waiting students to the console in promotion order.
+void WaitList::printList() const {
+    for (const Student* student : getStudents())
+        student->print();
+}
+
+// Getter
+// Precondition: None.
+// Postcondition: Returns the policy that orders the waitlist.
+const PromotionPolicy& WaitList::getPolicy() const { return *policy; }
+
+// Setter
+// Precondition: None.
+// Postcondition: Every waiting student is ranked again under `promotionPolicy`; students of equal rank keep
+// their arrival order.
+void WaitList::setPolicy(const PromotionPolicy& promotionPolicy) {
+    policy = &promotionPolicy;
+    vector<pair<int64_t, uint64_t>> keys;
+    keys.reserve(heap.size());
+    for (Entry& entry : heap) {
+        entry.rank = policy->rank(entry.student);
+        keys.push_back({entry.rank, entry.ticket});
     }
+    for (size_t slot = heap.size() / 2; slot-- > 0;)
+        siftDown(slot);
+    sort(keys.begin(), keys.end());
+    order.assign(keys);
 }
 
 // Course class
 // Constructor
 // Precondition: None.
-// Postcondition: Initializes the course with an empty code, title, enrollSize, and waitSize.
-Course::Course() : code(""), title(""), enrollSize(0), waitSize(0) {}
+// Postcondition: Initializes the course with no id, an empty code, title, enrollSize, and waitSize.
+Course::Course() : id(-1), code{0, 0}, title{0, 0}, enrollSize(0), waitSize(0), bitmap(nullptr), version(0) {}
 
-// Precondition: `courseCode` and `courseTitle` are non-empty strings, and `enrollNum` and `waitNum` are non-negative integers.
-// Postcondition: Initializes the course with the given values for code, title, enrollSize, and waitSize.
-Course::Course(const string& courseCode, const string& courseTitle, int enrollNum, int waitNum)
-        : code(courseCode), title(courseTitle), enrollSize(enrollNum), waitSize(waitNum) {}
+// Precondition: `courseId` is the course's position in the course list.
+// `courseCode` and `courseTitle` are non-empty strings, and `enrollNum` and `waitNum` are non-negative integers.
+// Postcondition: Initializes the course with the given values for id, code, title, enrollSize, and waitSize.
+// The code and title are copied to the arena.
+Course::Course(int courseId, string_view courseCode, string_view courseTitle, int enrollNum, int waitNum)
+        : id(courseId), code(StringArena::shared().store(courseCode)), title(StringArena::shared().store(courseTitle)),
+          enrollSize(enrollNum), waitSize(waitNum), bitmap(nullptr), version(0) {}
 
 // Getter
 // Precondition: None.
-// Postcondition: Returns the course's code.
-string Course::getCode() const {return code;}
+// Postcondition: Returns the course's position in the course list.
+int Course::getId() const {return id;}
+
+// Precondition: None.
+// Postcondition: Returns a view of the course's code, valid for the life of the program.
+string_view Course::getCode() const {return StringArena::shared().view(code);}
+
+// Precondition: None.
+// Postcondition: Returns a view of the course's title, valid for the life of the program.
+string_view Course::getTitle() const {return StringArena::shared().view(title);}
+
+// Precondition: None.
+// Postcondition: Returns the number of enrolled students.
+int Course::getEnrollSize() const {return enrollSize;}
 
 // Precondition: None.
-// Postcondition: Returns the course's title.
-string Course::getTitle() const {return title;}
+// Postcondition: Returns the number of students on the waitlist.
+int Course::getWaitSize() const {return waitSize;}
+
+// Precondition: None.
+// Postcondition: Returns the enrolled students of the course.
+const StudentRoster& Course::getRoster() const {return enrolledList;}
+
+// Precondition: None.
+// Postcondition: Returns the waitlist of the course.
+const WaitList& Course::getWaitList() const {return waitList;}
+
+// Precondition: None.
+// Postcondition: Returns the membership bitmap the course reports to, or nullptr.
+EnrollmentBitmap* Course::getBitmap() const {return bitmap;}
+
+// Precondition: None.
+// Postcondition: Returns a counter that changes whenever the roster or waitlist changes.
+uint64_t Course::getVersion() const {return version;}
+
+// Setter
+// Precondition: No transaction is running. `membershipBitmap` already holds this course's members, or is nullptr.
+// Postcondition: Every later change to the roster or waitlist is mirrored in `membershipBitmap`.
+void Course::attachBitmap(EnrollmentBitmap* membershipBitmap){
+    bitmap = membershipBitmap;
+}
 
 // Member function
+// Precondition: None.
+// Postcondition: The enrolled list and waitlist have room for the given number of students.
+void Course::reserve(int enrolledCount, int waitCount){
+    enrolledList.reserve(enrolledCount);
+    waitList.reserve(waitCount);
+}
+
+// Setter
+// Precondition: None.
+// Postcondition: The waitlist promotes in the order `policy` gives; students already waiting are re-ranked.
+void Course::setPromotionPolicy(const PromotionPolicy& policy) {
+    if (&policy == &waitList.getPolicy()) return;
+    version++;
+    waitList.setPolicy(policy);
+}
+
 // Precondition: `student` is a valid pointer to a Student object.
 // Postcondition: Adds the student to the enrolled list.
 void Course::addEnrollList(Student* student){
     enrolledList.add(student);
+    version++;
+    student->setStatus(id, EnrollStatus::ENROLLED);
+    if (bitmap != nullptr)
+        bitmap->set(id, student, true);
 }
 
 // Precondition: `student` is a valid pointer to a Student object.
-// Postcondition: Adds the student to the waitlist.
+// Postcondition: Adds the student to the back of the waitlist.
 void Course::addWaitList(Student* student){
-    waitList.add(student);
+    if (waitList.enqueue(student)) {
+        version++;
+        student->setStatus(id, EnrollStatus::WAIT);
+        if (bitmap != nullptr)
+            bitmap->set(id, student, true);
+    }
+}
+
+// Precondition: The enrolled list is empty and `enrolled` holds distinct students. Their schedules are set
+// by the caller (readSnapshot() gives each student its whole schedule at once).
+// Postcondition: The enrolled list holds the students.
+void Course::restoreRoster(vector<Student*> enrolled){
+    version++;
+    if (bitmap != nullptr)
+        for (Student* student : enrolled)
+            bitmap->set(id, student, true);
+    enrolledList.addAll(move(enrolled));
+}
+
+// Precondition: The waitlist is empty. `entries` hold distinct students with their saved arrival tickets.
+// Their schedules are set by the caller, as for restoreRoster().
+// Postcondition: The waitlist holds the students under the current policy, each keeping its ticket.
+void Course::restoreWaitList(vector<WaitList::Entry> entries){
+    version++;
+    if (bitmap != nullptr)
+        for (const WaitList::Entry& entry : entries)
+            bitmap->set(id, entry.student, true);
+    waitList.assign(move(entries));
 }
 
 // Precondition: `student` is a valid pointer to a Student object.
 // Postcondition: Adds the student to the enrolled list if enrollment is open, otherwise adds to the waitlist.
 bool Course::registerStudent(Student* student) {
+    METRIC_TIME(TimedOp::REGISTER);
+    version++;
+    if (bitmap != nullptr)
+        bitmap->set(id, student, true);
     // Check the enrolled list if full
     if (enrollSize < MAX_ENROLLED) {
         enrolledList.add(student);
         enrollSize++;
+        student->setStatus(id, EnrollStatus::ENROLLED);
+        METRIC_COUNT(Counter::ENROLLED);
         return true;
     }
-    // If enrolled list full, add the student to the waitlist
+    // If enrolled list full, add the student to the waitlist; a student already waiting keeps their place
     else {
-        waitList.add(student);
-        waitSize++;
+        if (waitList.enqueue(student)) {
+            waitSize++;
+            METRIC_COUNT(Counter::WAITLISTED);
+            METRIC_WAITLIST(id, waitSize);
+        }
+        student->setStatus(id, EnrollStatus::WAIT);
         return false;
     }
 }
 
+// Precondition: `newcomers` holds distinct students who are neither enrolled in nor waiting for this course.
+// Postcondition: Same as calling registerStudent() for each newcomer in order: the first open seats go to the
+// front of the list and the rest join the waitlist in order. Returns how many were enrolled.
+int Course::registerAll(const vector<Student*>& newcomers) {
+    int count = static_cast<int>(newcomers.size());
+    int seats = min(count, max(0, MAX_ENROLLED - enrollSize));
+    version++;
+    if (seats > 0) {
+        enrolledList.addAll(vector<Student*>(newcomers.begin(), newcomers.begin() + seats));
+        enrollSize += seats;
+    }
+    for (int i = 0; i < seats; i++) {
+        newcomers[i]->setStatus(id, EnrollStatus::ENROLLED);
+        if (bitmap != nullptr)
+            bitmap->set(id, newcomers[i], true);
+        METRIC_COUNT(Counter::ENROLLED);
+    }
+    if (seats == count)
+        return seats;
+    waitList.reserve(waitList.size() + count - seats);
+    for (int i = seats; i < count; i++) {
+        if (!waitList.enqueue(newcomers[i])) continue;
+        waitSize++;
+        newcomers[i]->setStatus(id, EnrollStatus::WAIT);
+        if (bitmap != nullptr)
+            bitmap->set(id, newcomers[i], true);
+        METRIC_COUNT(Counter::WAITLISTED);
+    }
+    METRIC_WAITLIST(id, waitSize);
+    return seats;
+}
+
 // Precondition: `student` is a valid pointer to a Student object.
-// Postcondition: Returns "Enrolled", "Wait", or "Not Found" depending on the student's status in the course.
-string Course::findStudent(Student* student){
+// Postcondition: Returns ENROLLED, WAIT, or NOT_FOUND depending on the student's status in the course.
+EnrollStatus Course::findStudent(const Student* student) const {
+    METRIC_TIME(TimedOp::FIND);
     if (enrolledList.find(student))
-        return "Enrolled";
+        return EnrollStatus::ENROLLED;
     if (waitList.find(student))
-        return "Wait";
+        return EnrollStatus::WAIT;
 
-    return "Not Found";
+    return EnrollStatus::NOT_FOUND;
+}
+
+// Precondition: `student` is a valid pointer to a Student object.
+// Postcondition: Returns the student's 1-based place on the waitlist, or 0 if the student is not waiting.
+int Course::waitlistPosition(const Student* student) const {
+    return waitList.position(student);
 }
 
 // Precondition: `student` is a valid pointer to a Student object.
 // Postcondition: Removes the student from the enrolled or waitlist.
 // If a student is removed from the enrolled list, promotes a student from the waitlist (if any).
 bool Course::cancelStudent(Student* student) {
-    string status = findStudent(student);
-    if (status == "Enrolled") {
+    METRIC_TIME(TimedOp::CANCEL);
+    EnrollStatus status = findStudent(student);
+    if (status == EnrollStatus::ENROLLED) {
+        // One bump covers the drop and the promotion that may follow
+        version++;
         enrolledList.remove(student);
         enrollSize--;
-        // Check the waitlist and move the first student to the enrolled list
+        student->setStatus(id, EnrollStatus::NOT_FOUND);
+        // Check the waitlist and move the student the promotion policy picks to the enrolled list
         if (waitSize > 0) {
-            Student* promotedStudent = waitList.removeFirst();
+            Student* promotedStudent = waitList.dequeue();
             if(promotedStudent != nullptr){
                 enrolledList.add(promotedStudent);
                 enrollSize++;
                 waitSize--;
+                promotedStudent->setStatus(id, EnrollStatus::ENROLLED);
+                METRIC_COUNT(Counter::PROMOTED);
+                METRIC_WAITLIST(id, waitSize);
             }
         }
+        METRIC_COUNT(Counter::DROPPED);
+        if (bitmap != nullptr)
+            bitmap->set(id, student, false);
         return true;
-    } else if (status == "Wait") {
+    } else if (status == EnrollStatus::WAIT) {
+        version++;
         waitList.remove(student);
         waitSize--;
+        student->setStatus(id, EnrollStatus::NOT_FOUND);
+        METRIC_COUNT(Counter::LEFT_WAITLIST);
+        METRIC_WAITLIST(id, waitSize);
+        if (bitmap != nullptr)
+            bitmap->set(id, student, false);
         return false;
     }
+    METRIC_COUNT(Counter::NOT_REGISTERED);
     return false;
 }
 
 // Precondition: None.
 // Postcondition: Prints all students of each course to the console in a formatted manner.
+// The section is formatted into one buffer and written with a single call.
 void Course::getAllInfo() {
-    cout << "[ " << left <<setw(10) << code << setw(15)<< title << " (" << enrollSize << ")  ]" << endl;
-    cout << "---------------------------------------" << endl;
-    enrolledList.printList();
-    cout << endl;
-    if (waitSize > 0) {
-        cout << "  <  Waitlist  (" << waitSize << ")  >" << endl;
-        waitList.printList();
-        cout << endl;
-    }
+    string section;
+    appendCourseSection(*this, ReportFormat::TEXT, section);
+    cout.write(section.data(), section.size());
+    cout.flush();
 }
 
-Course* readFile1(string filename, int& courseCount){
+vector<Course> readFile1(const string& filename){
     // Precondition: The file specified by `filename` exists and is readable.
     // Each line in the file contains exactly four entries: course code (string), course title (string),
     // number of enrolled students (int), and number of students on the waitlist (int).
 
-    // Postcondition: `courseCount` is updated to reflect the total number of courses read from the file.
-    // A dynamic array of `Course` objects is created and populated with the data from the file.
+    // Postcondition: Returns a dynamic array of `Course` objects populated with the data from the file.
+    // The file is memory-mapped and parsed in a single pass. Blank lines are ignored, and every
+    // malformed line is reported on stderr with its line number and skipped.
 
-    fstream infile;
-    infile.open(filename);
-    if(infile.fail()){
-        cout << "Input file opening failed." << endl;
+    METRIC_TIME(TimedOp::READ_COURSES);
+    MappedFile file(filename);
+    if(!file.isOpen()){
+        cerr << "Input file opening failed." << endl;
         exit(1);
     }
-    // Count the size of the dynamic array
-    string code, title;
+    vector<Course> courseList;
+    LineScanner scanner(file.begin(), file.end());
+    const char* codeBegin;
+    const char* codeEnd;
+    const char* titleBegin;
+    const char* titleEnd;
     int enrollNum, waitNum;
-    while(infile >> code >> title >> enrollNum >> waitNum)
-        courseCount ++;
-    infile.close();
-    Course* courseList = new Course[courseCount];
-    // Read file again for saving data to course list
-    infile.open(filename);
-    int i = 0;
-    while(infile >> code >> title >> enrollNum >> waitNum){
-        courseList[i] = Course(code, title, enrollNum, waitNum);
-        i++;
+    while(scanner.nextLine()){
+        if(scanner.atLineEnd())
+            continue;
+        if(!scanner.nextField(codeBegin, codeEnd) || !scanner.nextField(titleBegin, titleEnd)
+           || !scanner.nextInt(enrollNum) || !scanner.nextInt(waitNum) || !scanner.atLineEnd()){
+            cerr << filename << ":" << scanner.getLineNumber()
+                 << ": expected <code> <title> <enrolled> <waitlisted>, line skipped." << endl;
+            continue;
+        }
+        courseList.emplace_back(static_cast<int>(courseList.size()), string_view(codeBegin, codeEnd - codeBegin),
+                                string_view(titleBegin, titleEnd - titleBegin), enrollNum, waitNum);
     }
-    infile.close();
     return courseList;
 }
 
-void readFile2(string filename, Course* courseList, int courseCount){
+// Smallest slice worth a thread of its own
+static const size_t MIN_CHUNK_BYTES = size_t(1) << 20;
+
+// Precondition: [chunk.begin, chunk.end) holds whole lines of an enrollment file; `index` is read-only.
+// Postcondition: Every well-formed line is in `chunk.lines` with its placements (courses missing from
+// `index` are dropped), and every malformed line is listed in `chunk.badLines`. Nothing shared is changed,
+// so chunks can be parsed at the same time.
+static void parseEnrollmentChunk(EnrollmentChunk& chunk, const CourseIndex& index) {
+    LineScanner scanner(chunk.begin, chunk.end);
+    const char* nameBegin;
+    const char* nameEnd;
+    const char* codeBegin;
+    const char* codeEnd;
+    int id, count;
+    while (scanner.nextLine()) {
+        if (scanner.atLineEnd())
+            continue;
+        size_t firstPlacement = chunk.placements.size();
+        bool ok = scanner.nextInt(id) && scanner.nextField(nameBegin, nameEnd) && scanner.nextInt(count) && count >= 0;
+        // The enrolled group, then an optional waitlist group
+        bool waitlisted = false;
+        while (ok) {
+            for (int i = 0; ok && i < count; i++) {
+                ok = scanner.nextField(codeBegin, codeEnd);
+                int courseId = ok ? index.find(string_view(codeBegin, codeEnd - codeBegin)) : CourseIndex::NOT_FOUND;
+                if (courseId != CourseIndex::NOT_FOUND)
+                    chunk.placements.push_back(Placement{courseId, waitlisted});
+            }
+            if (!ok || scanner.atLineEnd())
+                break;
+            ok = !waitlisted && scanner.nextInt(count) && count >= 0;
+            waitlisted = true;
+        }
+        if (!ok) {
+            chunk.placements.resize(firstPlacement);
+            chunk.badLines.push_back(scanner.getLineNumber());
+            continue;
+        }
+        chunk.lines.push_back(EnrollmentLine{id, string_view(nameBegin, nameEnd - nameBegin),
+                                             static_cast<uint32_t>(chunk.placements.size())});
+    }
+    chunk.lineCount = scanner.getLineNumber();
+}
+
+// Precondition: [begin, end) holds an enrollment file; `index` is read-only. `threadCount` >= 1.
+// Postcondition: Returns the file split at line boundaries into at most `threadCount` chunks (fewer for a
+// small file), each parsed on its own thread; the chunks are in file order.
+vector<EnrollmentChunk> parseEnrollmentFile(const char* begin, const char* end, const CourseIndex& index,
+                                            int threadCount) {
+    size_t fileSize = end - begin;
+    size_t chunkCount = max<size_t>(1, min<size_t>(threadCount, fileSize / MIN_CHUNK_BYTES));
+    vector<EnrollmentChunk> chunks(chunkCount);
+    const char* chunkBegin = begin;
+    for (size_t i = 0; i < chunkCount; i++) {
+        const char* chunkEnd = max(chunkBegin, begin + fileSize / chunkCount * (i + 1));
+        if (i + 1 == chunkCount) {
+            chunkEnd = end;
+        } else if (chunkEnd < end) {
+            const char* newline = static_cast<const char*>(memchr(chunkEnd, '\n', end - chunkEnd));
+            chunkEnd = newline != nullptr ? newline + 1 : end;
+        }
+        chunks[i].begin = chunkBegin;
+        chunks[i].end = chunkEnd;
+        chunkBegin = chunkEnd;
+    }
+
+    // Parse every chunk on its own thread; this thread takes the first one
+    vector<thread> workers;
+    for (size_t i = 1; i < chunkCount; i++)
+        workers.emplace_back(parseEnrollmentChunk, ref(chunks[i]), cref(index));
+    parseEnrollmentChunk(chunks[0], index);
+    for (thread& worker : workers)
+        worker.join();
+    return chunks;
+}
+
+// Precondition: Every chunk's `students` are resolved; `shard` < `shardCount`.
+// Postcondition: Applies, in file order, every placement whose course id is `shard` modulo `shardCount`.
+// A course is only touched by its own shard, and Student::setStatus keeps the schedule sorted by course
+// under the student's lock, so shards can run at the same time and still give the sequential result.
+// Rosters and waitlists are sized once up front instead of growing (and rehashing) as students arrive.
+static void applyEnrollmentShard(const vector<EnrollmentChunk>& chunks, Course* courseList, int courseCount,
+                                 int shard, int shardCount) {
+    vector<int> enrolledCounts(courseCount, 0);
+    vector<int> waitCounts(courseCount, 0);
+    for (const EnrollmentChunk& chunk : chunks) {
+        for (const Placement& request : chunk.placements) {
+            if (request.courseId % shardCount == shard)
+                (request.waitlisted ? waitCounts : enrolledCounts)[request.courseId]++;
+        }
+    }
+    for (int courseId = shard; courseId < courseCount; courseId += shardCount) {
+        const Course& course = courseList[courseId];
+        courseList[courseId].reserve(course.getRoster().size() + enrolledCounts[courseId],
+                                     course.getWaitList().size() + waitCounts[courseId]);
+    }
+    for (const EnrollmentChunk& chunk : chunks) {
+        uint32_t placement = 0;
+        for (size_t line = 0; line < chunk.lines.size(); line++) {
+            for (; placement < chunk.lines[line].placementEnd; placement++) {
+                const Placement& request = chunk.placements[placement];
+                if (request.courseId % shardCount != shard)
+                    continue;
+                if (request.waitlisted)
+                    courseList[request.courseId].addWaitList(chunk.students[line]);
+                else
+                    courseList[request.courseId].addEnrollList(chunk.students[line]);
+            }
+        }
+    }
+}
+
+void readFile2(string filename, Course* courseList, const CourseIndex& index, StudentRegistry& registry,
+               int threadCount, bool placedOnly){
     // Precondition: The file specified by `filename` exists and is readable.
-    // Each student entry in the file starts with an integer ID and a string name,
+    // Each student entry in the file is one line: an integer ID and a string name,
     // followed by an integer indicating the number of enrolled courses,
     // followed by the course codes of those enrolled courses.
-    // Optionally, if there are waitlisted courses, they are listed after the enrolled courses.
+    // Optionally, if there are waitlisted courses, their count and codes follow on the same line.
+    // `index` was built from `courseList`. `threadCount` < 1 means one thread per core.
+    // `placedOnly` is set when `courseList` is one shard of a larger catalog.
 
     // Postcondition: Each student is added to the enrolled list of their respective courses.
     // If a course has reached its maximum enrollment, the student is added to the waitlist instead.
     // The `courseList` array is updated accordingly with the enrolled and waitlisted students.
-
-    fstream infile;
-    infile.open(filename);
-    if(infile.fail()){
-        cout << "Input file opening failed." << endl;
+    // Each student record is owned by `registry`; courses only hold pointers to it.
+    // The file is memory-mapped and split at line boundaries; the chunks are parsed on up to `threadCount`
+    // threads, student records are created in file order, and placements are applied per course in file
+    // order, so rosters, waitlist order and the registry match a one-thread load exactly. Blank lines are
+    // ignored, and every malformed line is reported on stderr with its line number and skipped. With `placedOnly`, a
+    // student none of whose courses are in `courseList` gets no record, so a shard keeps only its own students.
+
+    METRIC_TIME(TimedOp::READ_ENROLLMENT);
+    MappedFile file(filename);
+    if(!file.isOpen()){
+        cerr << "Input file opening failed." << endl;
         exit(1);
     }
-    int id, enrolledCourseNum, waitlistCourseNum;
-    string name, enrolledCourse, waitlistCourse;
-    while(infile >> id >> name){
-        // Create a new Student instance
-        Student* newStudent = new Student(id, name);
-        // Read the number of enrolled courses
-        infile >> enrolledCourseNum;
-        for(int enrolledIdx = 0; enrolledIdx < enrolledCourseNum; enrolledIdx++){
-            infile >> enrolledCourse;
-            // Find the corresponding course and add the student to the enrolled list
-            bool courseFound = false;
-            for(int j = 0; j < courseCount; j++){
-                if(courseList[j].getCode() == enrolledCourse){
-                    courseList[j].addEnrollList(newStudent);
-                    courseFound = true;
-                    break;
-                }
-            }
+    if (threadCount < 1)
+        threadCount = max(1u, thread::hardware_concurrency());
+    vector<EnrollmentChunk> chunks = parseEnrollmentFile(file.begin(), file.end(), index, threadCount);
+    size_t chunkCount = chunks.size();
+    vector<thread> workers;
+
+    // Look up or create the student records in file order, so the registry fills as a one-thread load would
+    size_t lineTotal = 0;
+    for (const EnrollmentChunk& chunk : chunks) {
+        uint32_t placementBegin = 0;
+        for (const EnrollmentLine& line : chunk.lines) {
+            lineTotal += !placedOnly || line.placementEnd > placementBegin;
+            placementBegin = line.placementEnd;
         }
-        // Peek to check if there are waitlist courses
-        if (infile.peek() != '\n' && !infile.eof()) {
-            infile >> waitlistCourseNum;
-            for (int waitlistIdx = 0; waitlistIdx < waitlistCourseNum; waitlistIdx++) {
-                infile >> waitlistCourse;
-                // Find the corresponding course and add the student to the waitlist
-                bool courseFound = false;
-                for(int j = 0; j < courseCount; j++){
-                    if(courseList[j].getCode() == waitlistCourse){
-                        courseList[j].addWaitList(newStudent);
-                        courseFound = true;
-                        break;
-                    }
-                }
-            }
+    }
+    registry.reserve(static_cast<int>(lineTotal));
+    int lineOffset = 0;
+    for (EnrollmentChunk& chunk : chunks) {
+        for (int badLine : chunk.badLines)
+            cerr << filename << ":" << lineOffset + badLine
+                 << ": expected <id> <name> <count> <codes> [<count> <codes>], line skipped." << endl;
+        lineOffset += chunk.lineCount;
+        chunk.students.reserve(chunk.lines.size());
+        uint32_t placementBegin = 0;
+        for (const EnrollmentLine& line : chunk.lines) {
+            bool placed = line.placementEnd > placementBegin;
+            placementBegin = line.placementEnd;
+            chunk.students.push_back(placed || !placedOnly ? registry.findOrAdd(line.id, line.name) : nullptr);
         }
     }
-    infile.close();
+
+    // Link the students into the courses, one shard of courses per thread
+    int shardCount = static_cast<int>(chunkCount);
+    for (int shard = 1; shard < shardCount; shard++)
+        workers.emplace_back(applyEnrollmentShard, cref(chunks), courseList, index.size(), shard, shardCount);
+    applyEnrollmentShard(chunks, courseList, index.size(), 0, shardCount);
+    for (thread& worker : workers)
+        worker.join();
 }
 
-void menu1(Course* courseList, int courseCount){
+void menu1(const Course* courseList, const StudentRegistry& registry){
     // Precondition: `courseList` points to a valid array of `Course` objects.
-    // `courseCount` accurately represents the number of courses in `courseList`.
+    // `registry` owns every student linked into `courseList`.
 
     // Postcondition: The function outputs the number of courses the student is enrolled in and waitlisted for.
     // It also lists the specific courses under "Registered" and "Waitlisted" categories.
+    // Only the student's own schedule is visited, not every course.
     // No changes are made to the underlying data structures.
 
     int id;
@@ -368,40 +788,42 @@ void menu1(Course* courseList, int courseCount){
     cout << "Enter your name : ";
     cin >> name;
     cout << endl;
-    // Create the student object
-    Student student(id, name);
-    // Go over the course list, print this student's course info
+    // Find the student record; a student the registry has never seen has no courses
+    const Student* student = registry.find(id, name);
+    // Go over the student's schedule, print this student's course info
+    vector<ScheduleEntry> schedule;
+    if (student != nullptr)
+        schedule = student->getSchedule();
     int registerNum = 0, waitlistNum = 0;
-    for (int i = 0; i < courseCount; i++) {
-        string status = courseList[i].findStudent(&student);
-        if (status == "Enrolled") {
+    for (const ScheduleEntry& entry : schedule) {
+        if (entry.status == EnrollStatus::ENROLLED) {
             registerNum++;
-        } else if (status == "Wait") {
+        } else if (entry.status == EnrollStatus::WAIT) {
             waitlistNum++;
         }
     }
     cout << "Your registered " << registerNum << " courses and waitlisted " << waitlistNum <<  " courses." << endl;
-    for(int i = 0; i < courseCount; i++){
-        string status = courseList[i].findStudent(&student);
-        if(status == "Enrolled")
-            cout << "(R) " << left << setw(15) << courseList[i].getCode() << setw(15) << courseList[i].getTitle() << endl;
+    for(const ScheduleEntry& entry : schedule){
+        const Course& course = courseList[entry.courseId];
+        if(entry.status == EnrollStatus::ENROLLED)
+            cout << "(R) " << left << setw(15) << course.getCode() << setw(15) << course.getTitle() << endl;
     }
-    for(int i = 0; i < courseCount; i++){
-        string status = courseList[i].findStudent(&student);
-        if (status == "Wait")
-            cout << "(W) " << left << setw(15) << courseList[i].getCode() << setw(15) << courseList[i].getTitle() << endl;
+    for(const ScheduleEntry& entry : schedule){
+        const Course& course = courseList[entry.courseId];
+        if (entry.status == EnrollStatus::WAIT)
+            cout << "(W) " << left << setw(15) << course.getCode() << setw(15) << course.getTitle() << endl;
     }
     cout << endl;
 }
 
-void menu2(Course* courseList, int courseCount){
+void menu2(const Course* courseList, const CourseIndex& index, RegistrationEngine& engine){
     // Precondition: `courseList` points to a valid array of `Course` objects.
-    // `courseCount` accurately represents the number of courses in `courseList`.
+    // `index` was built from `courseList`, and `engine` runs over `courseList`.
 
     // Postcondition: The student is either successfully enrolled in the specified course,
     // or added to the waitlist if the course is full.
     // A corresponding message is displayed to inform the user of the outcome.
-    // A new `Student` object is dynamically allocated and added to the course's enrollment or waitlist.
+    // The registration goes through `engine`, so it is logged when durable state is enabled.
 
     int id;
     string name, code, title;
@@ -414,15 +836,13 @@ void menu2(Course* courseList, int courseCount){
     cout << "Enter course title : ";
     cin >> title;
     cout << endl;
-    // Create the student object
-    Student* student = new Student(id, name);
     // Find the course info then register this student
     bool success = false;
-    for(int i = 0; i < courseCount; i++){
-        if(courseList[i].getCode() == code && courseList[i].getTitle() == title){
-            success = courseList[i].registerStudent(student);
-            break;
-        }
+    int courseId = index.find(code);
+    if(courseId != CourseIndex::NOT_FOUND && courseList[courseId].getTitle() == title){
+        success = engine.execute(Transaction{Operation::REGISTER, id, name, code, {}}).outcome == Outcome::ENROLLED;
+        if(!engine.commit())
+            cout << "Warning: the change could not be saved to disk." << endl;
     }
     if(success)
         cout << "Registration succeed!" << endl;
@@ -431,15 +851,15 @@ void menu2(Course* courseList, int courseCount){
     cout << endl;
 }
 
-void menu3(Course* courseList, int courseCount){
+void menu3(const Course* courseList, const CourseIndex& index, RegistrationEngine& engine){
     // Precondition: `courseList` points to a valid array of `Course` objects.
-    // `courseCount` accurately represents the number of courses in `courseList`.
+    // `index` was built from `courseList`, and `engine` runs over `courseList`.
 
     // Postcondition: The student is removed from the specified course's enrolled list or waitlist.
     // If removed from the enrolled list and the waitlist is not empty,
-    // the first student on the waitlist is promoted to the enrolled list.
+    // the student who has waited longest is promoted to the enrolled list.
     // A corresponding message is displayed to inform the user of the outcome.
-    // A new `Student` object is dynamically allocated and removed from the course's enrollment or waitlist.
+    // The cancellation goes through `engine`, so it is logged when durable state is enabled.
 
     int id;
     string name, code, title;
@@ -452,15 +872,13 @@ void menu3(Course* courseList, int courseCount){
     cout << "Enter course title : ";
     cin >> title;
     cout << endl;
-    // Create the student object
-    Student* student = new Student(id, name);
     // Find the course info then remove this student
     bool success = false;
-    for(int i = 0; i < courseCount; i++){
-        if(courseList[i].getCode() == code && courseList[i].getTitle() == title){
-            success = courseList[i].cancelStudent(student);
-            break;
-        }
+    int courseId = index.find(code);
+    if(courseId != CourseIndex::NOT_FOUND && courseList[courseId].getTitle() == title){
+        success = engine.execute(Transaction{Operation::CANCEL, id, name, code, {}}).outcome == Outcome::DROPPED;
+        if(!engine.commit())
+            cout << "Warning: the change could not be saved to disk." << endl;
     }
     if(success)
         cout << "'" << title << "' is removed from your course list." << endl;
@@ -469,56 +887,18 @@ void menu3(Course* courseList, int courseCount){
     cout << endl;
 }
 
-void menu4(Course* courseList, int courseCount){
+void menu4(Course* courseList, int courseCount, ReportCache& cache){
     // Precondition: `courseList` points to a valid array of `Course` objects.
     // `courseCount` accurately represents the number of courses in `courseList`.
+    // `cache` holds TEXT sections of these courses from earlier calls (or none yet).
 
     // Postcondition: The function outputs detailed information for each course,
     // including the list of enrolled students and those on the waitlist.
     // No changes are made to the underlying data structures.
+    // Only courses changed since the last call are formatted again (in parallel); every section is then
+    // written from the cache in catalog order.
 
-    for(int i = 0; i < courseCount; i++)
-        courseList[i].getAllInfo();
-    cout << endl;
-}
-
-int main() {
-
-    string filename1, filename2;
-    cout << "Enter course filename : ";
-    cin >> filename1;
-    cout << "Enter enrollment filename : ";
-    cin >> filename2;
+    cout.flush();
+    writeReport(courseList, courseCount, cache, stdout, max(1u, thread::hardware_concurrency()));
     cout << endl;
-
-    // Read file1 and save data to a dynamic array
-    int courseCount = 0;
-    Course* courseList = readFile1(filename1, courseCount);
-
-    // Read file2 and save data as two linked list that connect with the course list
-    readFile2(filename2, courseList, courseCount);
-
-    // Show the menu
-    int select;
-    do{
-        cout << "================= MENU =================" << endl;
-        cout << "  1. View your registration" << endl;
-        cout << "  2. Course registration" << endl;
-        cout << "  3. Course cancellation" << endl;
-        cout << "  4. Print enrollment list including waitlist" << endl;
-        cout << "  5. Exit" << endl;
-        cout << "  ---> Select : ";
-        cin >> select;
-        cout << endl;
-        if(select == 1)
-            menu1(courseList, courseCount);
-        else if(select == 2)
-            menu2(courseList, courseCount);
-        else if(select == 3)
-            menu3(courseList, courseCount);
-        else if(select == 4)
-            menu4(courseList, courseCount);
-    }while(select != 5);
-
-    return 0;
 }
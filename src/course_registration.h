@@ -1,74 +1,188 @@
 #ifndef COURSE_REGISTRATION_H
 #define COURSE_REGISTRATION_H
 
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "order_tree.h"
+#include "roster.h"
+#include "spin_lock.h"
+#include "string_arena.h"
 using namespace std;
 
 const int MAX_ENROLLED = 10;
 
+class CourseIndex;
+class EnrollmentBitmap;
+class StudentRegistry;
+class RegistrationEngine;
+class ReportCache;
+
+// A student's standing in one course.
+enum class EnrollStatus { NOT_FOUND, ENROLLED, WAIT };
+
+// One line of a student's schedule: a course (by its position in the course list) and the standing in it.
+struct ScheduleEntry {
+    int courseId;
+    EnrollStatus status;
+};
+
+// Compact record: the name lives in the shared StringArena and the lock sits in what would otherwise be
+// padding, so a student takes 40 bytes plus its name instead of 72 plus a possible string block.
 class Student {
 private:
     int id;
-    string name;
+    mutable SpinLock scheduleLock;
+    StringRef name;
+    // Reverse index of the courses this student is in, sorted by course id.
+    // Kept up to date by Course, so a schedule view only touches this student's own courses.
+    // Different courses may update it at the same time, so every access holds `scheduleLock`.
+    vector<ScheduleEntry> schedule;
 public:
-    Student(const int& studentId, const string& studentName);
+    Student(int studentId, string_view studentName);
     int getId() const;
-    string getName() const;
+    string_view getName() const;
+    vector<ScheduleEntry> getSchedule() const;
+    EnrollStatus getStatus(int courseId) const;
+    void setStatus(int courseId, EnrollStatus status);
+    void setSchedule(vector<ScheduleEntry> entries);
     bool equals(const Student* other) const;
     void print() const;
 };
 
-class Node {
-private:
-    Student* data;
-    Node* next;
-public:
-    Node(Student* student);
-    Student* getData();
-    Node* getNext();
-    void setData(Student* Data);
-    void setNext(Node* Next);
+// Roster key for students: the id, taken once when a student is added to a roster.
+struct StudentIdKey {
+    using type = int;
+    int operator()(const Student* student) const { return student->getId(); }
+};
+
+// Enrolled students of one course, sorted by id.
+using StudentRoster = Roster<Student*, StudentIdKey>;
+
+// Decides who leaves a waitlist first. `rank` is computed once, when a student joins the waitlist; the
+// lowest rank is promoted first and equal ranks go in arrival order. Add a policy by giving it a rank
+// function (e.g. reserved seats for a major rank that major's students below everyone else).
+struct PromotionPolicy {
+    const char* name;
+    int64_t (*rank)(const Student* student);
+
+    static const PromotionPolicy FIFO;          // arrival order only (the default)
+    static const PromotionPolicy SENIORITY;     // lower student id (earlier matriculation) first
+    static const PromotionPolicy* find(const string& name);
 };
 
-class SingleLinkedList {
+// Waitlist of one course: an indexed binary min-heap ordered by (policy rank, arrival ticket).
+// `slots` maps a student to its heap position, so joining, promoting and leaving from the middle each
+// take O(log n), and membership checks never walk the queue. `order` holds the same (rank, ticket) keys in
+// an order-statistic tree, so a student's place in line is also O(log n).
+class WaitList {
+public:
+    struct Entry {
+        int64_t rank;
+        uint64_t ticket;
+        Student* student;
+    };
+    static bool before(const Entry& a, const Entry& b);
 private:
-    Node* head;
+    vector<Entry> heap;
+    unordered_map<const Student*, size_t> slots;
+    OrderTree<pair<int64_t, uint64_t>> order;
+    uint64_t nextTicket;
+    const PromotionPolicy* policy;
+    void siftUp(size_t slot);
+    void siftDown(size_t slot);
 public:
-    SingleLinkedList();
-    ~SingleLinkedList();
-    void add(Student* student);
-    bool remove(Student* student);
-    bool find(Student* student) const;
-    Student* removeFirst();
+    WaitList();
+    bool enqueue(Student* student);
+    Student* dequeue();
+    bool remove(const Student* student);
+    bool find(const Student* student) const;
+    int position(const Student* student) const;
+    int size() const;
+    void reserve(int count);
+    void assign(vector<Entry> entries);
+    vector<Student*> getStudents() const;
+    const vector<Entry>& getEntries() const;
     void printList() const;
+    const PromotionPolicy& getPolicy() const;
+    void setPolicy(const PromotionPolicy& promotionPolicy);
 };
 
+// The code and title live in the shared StringArena. Inside the program a course is known by its id,
+// its position in the course list; CourseIndex turns a code into that id once per request.
 class Course {
 private:
-    string code;
-    string title;
+    int id;
+    StringRef code;
+    StringRef title;
     int enrollSize;
     int waitSize;
-    SingleLinkedList enrolledList;
-    SingleLinkedList waitList;
+    StudentRoster enrolledList;
+    WaitList waitList;
+    EnrollmentBitmap* bitmap;       // mirrors membership changes when attached, otherwise nullptr
+    uint64_t version;               // bumped by every roster or waitlist change (see ReportCache)
 public:
     Course();
-    Course(const string& courseCode, const string& courseTitle, int enrollNum, int waitNum);
-    string getCode() const;
-    string getTitle() const;
+    Course(int courseId, string_view courseCode, string_view courseTitle, int enrollNum, int waitNum);
+    int getId() const;
+    string_view getCode() const;
+    string_view getTitle() const;
+    int getEnrollSize() const;
+    int getWaitSize() const;
+    const StudentRoster& getRoster() const;
+    const WaitList& getWaitList() const;
+    EnrollmentBitmap* getBitmap() const;
+    uint64_t getVersion() const;
+    void attachBitmap(EnrollmentBitmap* membershipBitmap);
+    void setPromotionPolicy(const PromotionPolicy& policy);
+    void reserve(int enrolledCount, int waitCount);
     void addEnrollList(Student* student);
     void addWaitList(Student* student);
+    void restoreRoster(vector<Student*> enrolled);
+    void restoreWaitList(vector<WaitList::Entry> entries);
     bool registerStudent(Student* student);
+    int registerAll(const vector<Student*>& newcomers);
     bool cancelStudent(Student* student);
-    string findStudent(Student* student);
+    EnrollStatus findStudent(const Student* student) const;
+    int waitlistPosition(const Student* student) const;
     void getAllInfo();
 };
 
-Course* readFile1(string filename, int& courseCount);
-void readFile2(string filename2, Course* courseList, int courseCount);
-void menu1(Course* courseList, int courseCount);
-void menu2(Course* courseList, int courseCount);
-void menu3(Course* courseList, int courseCount);
-void menu4(Course* courseList, int courseCount);
+// One student line of the enrollment file, as parsed by a loader thread
+struct EnrollmentLine {
+    int id;
+    string_view name;
+    uint32_t placementEnd;      // this line's placements end here in its chunk's list
+};
+
+// One (course, enrolled/waitlisted) request of a student line
+struct Placement {
+    int courseId;
+    bool waitlisted;
+};
+
+// A slice of the enrollment file made of whole lines, and what was parsed from it
+struct EnrollmentChunk {
+    const char* begin;
+    const char* end;
+    vector<EnrollmentLine> lines;
+    vector<Placement> placements;
+    vector<Student*> students;  // record for each line, filled in after parsing
+    vector<int> badLines;       // line numbers within the chunk
+    int lineCount = 0;
+};
+
+vector<Course> readFile1(const string& filename);
+vector<EnrollmentChunk> parseEnrollmentFile(const char* begin, const char* end, const CourseIndex& index,
+                                            int threadCount);
+void readFile2(string filename2, Course* courseList, const CourseIndex& index, StudentRegistry& registry,
+               int threadCount = 0, bool placedOnly = false);
+void menu1(const Course* courseList, const StudentRegistry& registry);
+void menu2(const Course* courseList, const CourseIndex& index, RegistrationEngine& engine);
+void menu3(const Course* courseList, const CourseIndex& index, RegistrationEngine& engine);
+void menu4(Course* courseList, int courseCount, ReportCache& cache);
 
 #endif //COURSE_REGISTRATION_H
\ No newline at end of file
@@ -0,0 +1,321 @@
+// Multi-threaded registration engine with one lock per course.
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <unordered_map>
+#include <utility>
+#include "course_index.h"
+#include "engine.h"
+#include "enrollment_bitmap.h"
+#include "persistence.h"
+#include "snapshot.h"
+#include "student_registry.h"
+
+using namespace std;
+
+// RegistrationEngine class
+// Constructor
+// Precondition: `index` was built from `courseList`, `registry` owns every student linked into `courseList`,
+// and `threadCount` >= 1.
+// Postcondition: The engine is ready; `threadCount` - 1 worker threads are started, and the calling thread
+// of executeAll() works alongside them.
+RegistrationEngine::RegistrationEngine(Course* courseList, const CourseIndex& index, StudentRegistry& registry,
+                                       int threadCount)
+        : courseList(courseList), index(index), registry(registry),
+          state(nullptr), snapshots(nullptr),
+          courseLocks(new mutex[max(1, index.size())]),
+          job(nullptr),
+          generation(0), busyWorkers(0), stopping(false) {
+    for (int i = 1; i < threadCount; i++)
+        workers.emplace_back(&RegistrationEngine::workerLoop, this);
+}
+
+// Destructor
+// Precondition: No executeAll() call is in progress.
+// Postcondition: All worker threads are stopped and joined.
+RegistrationEngine::~RegistrationEngine() {
+    {
+        lock_guard<mutex> guard(jobLock);
+        stopping = true;
+    }
+    jobReady.notify_all();
+    for (thread& worker : workers)
+        worker.join();
+}
+
+// Member function
+// Precondition: No transaction is running. `durableState` has been opened over the same courses, or is nullptr.
+// Postcondition: Changes made from now on are logged to `durableState`.
+void RegistrationEngine::attach(DurableState* durableState) {
+    state = durableState;
+}
+
+// Precondition: No transaction is running. `snapshotStore` was built over the same courses, or is nullptr.
+// Postcondition: Courses changed from now on are marked in `snapshotStore` for its next publish().
+void RegistrationEngine::attach(SnapshotStore* snapshotStore) {
+    snapshots = snapshotStore;
+}
+
+// Precondition: None. Safe to call from any number of threads.
+// Postcondition: The transaction is applied while holding its course's lock and the outcome is returned.
+// If it changed the course and durable state is attached, it is logged before the lock is released;
+// call commit() to wait until it is on disk. With a SnapshotStore attached, a changed course is marked for
+// the next publish.
+TransactionResult RegistrationEngine::execute(const Transaction& transaction) {
+    if (transaction.op == Operation::OVERLAP) {
+        int first = index.find(transaction.code);
+        int second = index.find(transaction.otherCode);
+        if (first == CourseIndex::NOT_FOUND || second == CourseIndex::NOT_FOUND)
+            return executeOverlap(first, second, courseList, nullptr);
+        // A bitmap locks its own rows; its answer stands unless it was given up while counting, because
+        // rows stop following the rosters from then on. Otherwise hold both courses, lower id first.
+        const EnrollmentBitmap* bitmap = courseList[first].getBitmap();
+        if (bitmap != nullptr && bitmap->isValid()) {
+            TransactionResult result = executeOverlap(first, second, courseList, bitmap);
+            if (bitmap->isValid())
+                return result;
+        }
+        lock_guard<mutex> lowGuard(courseLocks[min(first, second)]);
+        unique_lock<mutex> highGuard;
+        if (first != second)
+            highGuard = unique_lock<mutex>(courseLocks[max(first, second)]);
+        return executeOverlap(first, second, courseList, nullptr);
+    }
+    int courseId = transaction.op == Operation::QUERY ? CourseIndex::NOT_FOUND : index.find(transaction.code);
+    if (courseId == CourseIndex::NOT_FOUND)
+        return executeTransaction(transaction, courseId, courseList, registry);
+    lock_guard<mutex> guard(courseLocks[courseId]);
+    TransactionResult result = executeTransaction(transaction, courseId, courseList, registry);
+    if (state != nullptr && result.changed)
+        state->log(transaction);
+    if (snapshots != nullptr && result.changed)
+        snapshots->markChanged(courseId);
+    return result;
+}
+
+// Precondition: No transaction is running.
+// Postcondition: Every logged change is on disk (and a checkpoint is taken if the log has grown large).
+// Returns false if durable state is attached and could not be written.
+bool RegistrationEngine::commit() {
+    return state == nullptr || state->commit();
+}
+
+// Precondition: None.
+// Postcondition: Returns true for requests that only read (QUERY and OVERLAP).
+static bool isRead(const Transaction& transaction) {
+    return transaction.op == Operation::QUERY || transaction.op == Operation::OVERLAP;
+}
+
+// Precondition: None.
+// Postcondition: Every transaction is applied and `results[i]`/`latencies[i]` (nanoseconds) describe
+// `transactions[i]`. The results are those of applying the transactions one by one in input order, whatever
+// the thread count. The batch is split into runs of changes and runs of reads; long runs use every thread
+// (changes grouped by course, see applyGrouped()), short ones are applied in order on the calling thread.
+// When durable state is attached, every change in the batch is on disk before this returns.
+void RegistrationEngine::executeAll(const vector<Transaction>& transactions, vector<TransactionResult>& results,
+                                    vector<uint32_t>& latencies) {
+    results.resize(transactions.size());
+    latencies.resize(transactions.size());
+    size_t first = 0;
+    while (first < transactions.size()) {
+        bool reads = isRead(transactions[first]);
+        size_t last = first + 1;
+        while (last < transactions.size() && isRead(transactions[last]) == reads)
+            last++;
+        if (last - first < GROUP_MIN || (reads && workers.empty()))
+            executeRange(transactions, first, last, results, latencies);
+        else if (reads)
+            executeReads(transactions, first, last, results, latencies);
+        else
+            applyGrouped(transactions, first, last, results, latencies);
+        first = last;
+    }
+    if (!commit())
+        cerr << "Write-ahead log could not be written; recent changes are not durable." << endl;
+}
+
+// Precondition: Called by the thread running executeAll().
+// Postcondition: `work` has run to completion on every worker and on the calling thread.
+void RegistrationEngine::runOnAllThreads(const function<void()>& work) {
+    {
+        lock_guard<mutex> guard(jobLock);
+        job = &work;
+        busyWorkers = static_cast<int>(workers.size());
+        generation++;
+    }
+    jobReady.notify_all();
+    work();
+    unique_lock<mutex> guard(jobLock);
+    jobDone.wait(guard, [this] { return busyWorkers == 0; });
+}
+
+// Precondition: `first` <= `last` <= transactions.size().
+// Postcondition: The transactions in [`first`, `last`) are executed one by one in order on this thread.
+void RegistrationEngine::executeRange(const vector<Transaction>& transactions, size_t first, size_t last,
+                                      vector<TransactionResult>& results, vector<uint32_t>& latencies) {
+    using clock = chrono::steady_clock;
+    for (size_t i = first; i < last; i++) {
+        auto opStart = clock::now();
+        results[i] = execute(transactions[i]);
+        auto opEnd = clock::now();
+        latencies[i] = static_cast<uint32_t>(chrono::duration_cast<chrono::nanoseconds>(opEnd - opStart).count());
+    }
+}
+
+// Precondition: [`first`, `last`) holds only QUERY and OVERLAP transactions.
+// Postcondition: The transactions are executed on every thread, CHUNK at a time; reads see the same data in
+// any order because nothing changes until the run is over.
+void RegistrationEngine::executeReads(const vector<Transaction>& transactions, size_t first, size_t last,
+                                      vector<TransactionResult>& results, vector<uint32_t>& latencies) {
+    atomic<size_t> next(first);
+    function<void()> work = [&]() {
+        size_t start;
+        while ((start = next.fetch_add(CHUNK)) < last)
+            executeRange(transactions, start, min(last, start + CHUNK), results, latencies);
+    };
+    runOnAllThreads(work);
+}
+
+// Precondition: [`first`, `last`) holds only REGISTER and CANCEL transactions.
+// Postcondition: The transactions are grouped by course (keeping arrival order inside each group) and the
+// groups are applied on every thread through applyGroup(). Requests for different courses never affect each
+// other, so the results equal those of applying the run one by one. Each transaction's latency is its
+// group's time divided by the group's size.
+void RegistrationEngine::applyGrouped(const vector<Transaction>& transactions, size_t first, size_t last,
+                                      vector<TransactionResult>& results, vector<uint32_t>& latencies) {
+    using clock = chrono::steady_clock;
+    // Sorting (course, position) pairs puts each course's requests together in arrival order
+    vector<pair<int, uint32_t>> byCourse;
+    byCourse.reserve(last - first);
+    for (size_t i = first; i < last; i++) {
+        int courseId = index.find(transactions[i].code);
+        if (courseId == CourseIndex::NOT_FOUND) {
+            results[i] = executeTransaction(transactions[i], courseId, courseList, registry);
+            latencies[i] = 0;
+        } else {
+            // New students join the registry in arrival order, as they would one by one
+            if (transactions[i].op == Operation::REGISTER)
+                registry.findOrAdd(transactions[i].studentId, transactions[i].name);
+            byCourse.emplace_back(courseId, static_cast<uint32_t>(i));
+        }
+    }
+    sort(byCourse.begin(), byCourse.end());
+    vector<uint32_t> positions(byCourse.size());
+    vector<size_t> groupStarts;
+    for (size_t i = 0; i < byCourse.size(); i++) {
+        positions[i] = byCourse[i].second;
+        if (i == 0 || byCourse[i].first != byCourse[i - 1].first)
+            groupStarts.push_back(i);
+    }
+    groupStarts.push_back(byCourse.size());
+
+    atomic<size_t> nextGroup(0);
+    function<void()> work = [&]() {
+        size_t group;
+        while ((group = nextGroup.fetch_add(1)) + 1 < groupStarts.size()) {
+            size_t begin = groupStarts[group];
+            size_t count = groupStarts[group + 1] - begin;
+            auto groupStart = clock::now();
+            applyGroup(byCourse[begin].first, transactions, positions.data() + begin, count, results);
+            auto groupEnd = clock::now();
+            uint32_t share = static_cast<uint32_t>(
+                    chrono::duration_cast<chrono::nanoseconds>(groupEnd - groupStart).count() / count);
+            for (size_t i = 0; i < count; i++)
+                latencies[positions[begin + i]] = share;
+        }
+    };
+    if (workers.empty())
+        work();
+    else
+        runOnAllThreads(work);
+}
+
+// Precondition: `positions` lists `count` REGISTER/CANCEL transactions for course `courseId`, in arrival order.
+// Postcondition: They are applied in that order while the course lock is held once, with the results of
+// one-by-one execution. Each unbroken stretch of REGISTERs from students not yet in the course is applied
+// with a single Course::registerAll call; a repeated request inside the stretch gets the standing the first
+// one received. Changes are logged in arrival order when durable state is attached, and the course is
+// marked for the next snapshot when it changed.
+void RegistrationEngine::applyGroup(int courseId, const vector<Transaction>& transactions, const uint32_t* positions,
+                                    size_t count, vector<TransactionResult>& results) {
+    lock_guard<mutex> guard(courseLocks[courseId]);
+    Course& course = courseList[courseId];
+    uint64_t versionBefore = course.getVersion();
+    vector<Student*> newcomers;
+    vector<uint32_t> newcomerPositions;
+    vector<pair<uint32_t, size_t>> repeats;     // (position, index of the newcomer it repeats)
+    unordered_map<const Student*, size_t> pending;
+    size_t k = 0;
+    while (k < count) {
+        const Transaction& transaction = transactions[positions[k]];
+        if (transaction.op == Operation::CANCEL) {
+            TransactionResult& result = results[positions[k]];
+            result = executeTransaction(transaction, courseId, courseList, registry);
+            if (state != nullptr && result.changed)
+                state->log(transaction);
+            k++;
+            continue;
+        }
+        // Collect the stretch of REGISTERs up to the next CANCEL
+        newcomers.clear();
+        newcomerPositions.clear();
+        repeats.clear();
+        pending.clear();
+        for (; k < count && transactions[positions[k]].op == Operation::REGISTER; k++) {
+            const Transaction& request = transactions[positions[k]];
+            TransactionResult& result = results[positions[k]];
+            result = TransactionResult{Outcome::NOT_REGISTERED, false, {}};
+            Student* student = registry.findOrAdd(request.studentId, request.name);
+            EnrollStatus status = student->getStatus(courseId);
+            if (status != EnrollStatus::NOT_FOUND) {
+                result.outcome = status == EnrollStatus::ENROLLED ? Outcome::ENROLLED : Outcome::WAITLISTED;
+                continue;
+            }
+            auto earlier = pending.find(student);
+            if (earlier != pending.end()) {
+                repeats.emplace_back(positions[k], earlier->second);
+                continue;
+            }
+            pending.emplace(student, newcomers.size());
+            newcomers.push_back(student);
+            newcomerPositions.push_back(positions[k]);
+        }
+        if (newcomers.empty()) continue;
+        size_t enrolled = static_cast<size_t>(course.registerAll(newcomers));
+        for (size_t i = 0; i < newcomers.size(); i++) {
+            TransactionResult& result = results[newcomerPositions[i]];
+            result.outcome = i < enrolled ? Outcome::ENROLLED : Outcome::WAITLISTED;
+            result.changed = true;
+            if (state != nullptr)
+                state->log(transactions[newcomerPositions[i]]);
+        }
+        for (const pair<uint32_t, size_t>& repeat : repeats)
+            results[repeat.first].outcome = repeat.second < enrolled ? Outcome::ENROLLED : Outcome::WAITLISTED;
+    }
+    if (snapshots != nullptr && course.getVersion() != versionBefore)
+        snapshots->markChanged(courseId);
+}
+
+// Precondition: None.
+// Postcondition: Runs on a worker thread until the engine is destroyed, joining every published batch.
+void RegistrationEngine::workerLoop() {
+    uint64_t seen = 0;
+    while (true) {
+        {
+            unique_lock<mutex> guard(jobLock);
+            jobReady.wait(guard, [this, seen] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        (*job)();
+        lock_guard<mutex> guard(jobLock);
+        if (--busyWorkers == 0)
+            jobDone.notify_one();
+    }
+}
+
+// Getter
+// Precondition: None.
+// Postcondition: Returns the number of threads that execute a batch, including the caller.
+int RegistrationEngine::getThreadCount() const { return static_cast<int>(workers.size()) + 1; }
@@ -0,0 +1,77 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "batch.h"
+#include "course_registration.h"
+using namespace std;
+
+class DurableState;
+class SnapshotStore;
+
+// Runs transactions against the course data from several threads at once.
+// Each course has its own mutex, so requests for different courses never wait for each other, while the
+// capacity check, the roster/waitlist update and waitlist promotion of one course happen as one step.
+// Student schedules and the registry carry their own locks (see Student and StudentRegistry).
+// With a DurableState attached, every change is logged while its course lock is held.
+// With a SnapshotStore attached, every changed course is marked for the store's next publish().
+// OVERLAP holds both courses' locks (lower id first) unless an EnrollmentBitmap answers it from its own rows.
+//
+// executeAll() gives the results of applying a batch one request at a time in arrival order, on any number
+// of threads: long runs of REGISTER/CANCEL are grouped by course, each group is applied in arrival order
+// under one lock acquisition (consecutive new registrations in one merge, see Course::registerAll), and
+// groups run in parallel; QUERY and OVERLAP only read, so a run of them runs in parallel between the
+// groups before and after it.
+class RegistrationEngine {
+private:
+    Course* courseList;
+    const CourseIndex& index;
+    StudentRegistry& registry;
+    DurableState* state;
+    SnapshotStore* snapshots;
+    unique_ptr<mutex[]> courseLocks;
+    vector<thread> workers;
+
+    // The work of the current executeAll() step; every thread runs it until it finds nothing left to claim
+    static const size_t CHUNK = 64;
+    static const size_t GROUP_MIN = 64;     // shorter runs are applied one by one on the calling thread
+    const function<void()>* job;
+    mutex jobLock;
+    condition_variable jobReady;
+    condition_variable jobDone;
+    uint64_t generation;
+    int busyWorkers;
+    bool stopping;
+
+    void workerLoop();
+    void runOnAllThreads(const function<void()>& work);
+    void executeRange(const vector<Transaction>& transactions, size_t first, size_t last,
+                      vector<TransactionResult>& results, vector<uint32_t>& latencies);
+    void executeReads(const vector<Transaction>& transactions, size_t first, size_t last,
+                      vector<TransactionResult>& results, vector<uint32_t>& latencies);
+    void applyGrouped(const vector<Transaction>& transactions, size_t first, size_t last,
+                      vector<TransactionResult>& results, vector<uint32_t>& latencies);
+    void applyGroup(int courseId, const vector<Transaction>& transactions, const uint32_t* positions, size_t count,
+                    vector<TransactionResult>& results);
+public:
+    RegistrationEngine(Course* courseList, const CourseIndex& index, StudentRegistry& registry, int threadCount);
+    ~RegistrationEngine();
+    RegistrationEngine(const RegistrationEngine&) = delete;
+    RegistrationEngine& operator=(const RegistrationEngine&) = delete;
+    void attach(DurableState* durableState);
+    void attach(SnapshotStore* snapshotStore);
+    TransactionResult execute(const Transaction& transaction);
+    bool commit();
+    void executeAll(const vector<Transaction>& transactions, vector<TransactionResult>& results,
+                    vector<uint32_t>& latencies);
+    int getThreadCount() const;
+};
+
+#endif //ENGINE_H
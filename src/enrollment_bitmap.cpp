@@ -0,0 +1,338 @@
+// Student x course membership bitmap with vectorized set queries.
+
+#include <algorithm>
+#include <mutex>
+#include "enrollment_bitmap.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BITMAP_X86 1
+#endif
+
+using namespace std;
+
+static const uint32_t NO_COLUMN = UINT32_MAX;
+
+// Word kernels: each returns the number of set bits in (a AND b), or (a OR b) when UNITE is true.
+typedef size_t (*CountKernel)(const uint64_t* a, const uint64_t* b, size_t words);
+
+template <bool UNITE>
+static size_t countScalar(const uint64_t* a, const uint64_t* b, size_t words) {
+    size_t total = 0;
+    for (size_t i = 0; i < words; i++)
+        total += __builtin_popcountll(UNITE ? a[i] | b[i] : a[i] & b[i]);
+    return total;
+}
+
+#ifdef BITMAP_X86
+// Two words per step with the hardware POPCNT instruction.
+template <bool UNITE>
+__attribute__((target("sse4.2,popcnt")))
+static size_t countSse(const uint64_t* a, const uint64_t* b, size_t words) {
+    size_t total = 0;
+    size_t i = 0;
+    for (; i + 2 <= words; i += 2) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        __m128i v = UNITE ? _mm_or_si128(x, y) : _mm_and_si128(x, y);
+        total += _mm_popcnt_u64(static_cast<uint64_t>(_mm_cvtsi128_si64(v)))
+                 + _mm_popcnt_u64(static_cast<uint64_t>(_mm_extract_epi64(v, 1)));
+    }
+    for (; i < words; i++)
+        total += _mm_popcnt_u64(UNITE ? a[i] | b[i] : a[i] & b[i]);
+    return total;
+}
+
+// Four words per step; bits are counted inside the vector register with a nibble lookup table
+// (PSHUFB) and summed per 64-bit lane with PSADBW, so no scalar POPCNT is needed in the loop.
+template <bool UNITE>
+__attribute__((target("avx2")))
+static size_t countAvx2(const uint64_t* a, const uint64_t* b, size_t words) {
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i lowNibble = _mm256_set1_epi8(0x0f);
+    __m256i sums = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= words; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        __m256i v = UNITE ? _mm256_or_si256(x, y) : _mm256_and_si256(x, y);
+        __m256i low = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, lowNibble));
+        __m256i high = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), lowNibble));
+        sums = _mm256_add_epi64(sums, _mm256_sad_epu8(_mm256_add_epi8(low, high), _mm256_setzero_si256()));
+    }
+    size_t total = static_cast<size_t>(_mm256_extract_epi64(sums, 0)) + static_cast<size_t>(_mm256_extract_epi64(sums, 1))
+                   + static_cast<size_t>(_mm256_extract_epi64(sums, 2)) + static_cast<size_t>(_mm256_extract_epi64(sums, 3));
+    for (; i < words; i++)
+        total += __builtin_popcountll(UNITE ? a[i] | b[i] : a[i] & b[i]);
+    return total;
+}
+#endif
+
+struct Kernels {
+    const char* name;
+    CountKernel intersect;
+    CountKernel unite;
+};
+
+static const Kernels scalarKernels = {"scalar", countScalar<false>, countScalar<true>};
+
+// Precondition: None.
+// Postcondition: Returns the widest kernels this CPU can run.
+static Kernels detectKernels() {
+#ifdef BITMAP_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return Kernels{"avx2", countAvx2<false>, countAvx2<true>};
+    if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt"))
+        return Kernels{"sse4.2", countSse<false>, countSse<true>};
+#endif
+    return scalarKernels;
+}
+
+static Kernels kernels = detectKernels();
+
+// Holds the spin locks of one or two rows, taken in ascending course order.
+class RowGuard {
+private:
+    SpinLock& low;
+    SpinLock* high;
+public:
+    RowGuard(SpinLock* rowLocks, int first, int second)
+            : low(rowLocks[min(first, second)]), high(first != second ? &rowLocks[max(first, second)] : nullptr) {
+        low.lock();
+        if (high != nullptr) high->lock();
+    }
+    ~RowGuard() {
+        if (high != nullptr) high->unlock();
+        low.unlock();
+    }
+    RowGuard(const RowGuard&) = delete;
+    RowGuard& operator=(const RowGuard&) = delete;
+};
+
+// EnrollmentBitmap class
+// Constructor
+// Precondition: None.
+// Postcondition: Creates an empty bitmap that will refuse to grow beyond `byteLimit` bytes of rows.
+EnrollmentBitmap::EnrollmentBitmap(size_t byteLimit)
+        : courseCount(0), words(0), maxBytes(byteLimit), valid(false) {}
+
+// Precondition: None.
+// Postcondition: Returns the bytes of rows needed for `courseCount` courses and `studentCount` students.
+size_t EnrollmentBitmap::bytesFor(int courseCount, int studentCount) {
+    return static_cast<size_t>(courseCount) * ((static_cast<size_t>(studentCount) + 63) / 64) * sizeof(uint64_t);
+}
+
+// Precondition: None.
+// Postcondition: Returns the name of the kernel set in use: "avx2", "sse4.2" or "scalar".
+const char* EnrollmentBitmap::kernelName() {
+    return kernels.name;
+}
+
+// Precondition: No query or update is running. Meant for benchmarks.
+// Postcondition: Switches to the named kernel set and returns true, or returns false if this CPU cannot run it
+// (the current kernels are kept).
+bool EnrollmentBitmap::useKernel(const string& name) {
+    if (name == "scalar") {
+        kernels = scalarKernels;
+        return true;
+    }
+#ifdef BITMAP_X86
+    __builtin_cpu_init();
+    if (name == "avx2" && __builtin_cpu_supports("avx2")) {
+        kernels = Kernels{"avx2", countAvx2<false>, countAvx2<true>};
+        return true;
+    }
+    if (name == "sse4.2" && __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt")) {
+        kernels = Kernels{"sse4.2", countSse<false>, countSse<true>};
+        return true;
+    }
+#endif
+    return false;
+}
+
+// Precondition: 0 <= `courseId` < courseCount.
+// Postcondition: Returns the first word of the course's row.
+const uint64_t* EnrollmentBitmap::row(int courseId) const {
+    return bits.data() + static_cast<size_t>(courseId) * words;
+}
+
+// Precondition: 0 <= `courseId` < courseCount.
+// Postcondition: Returns the first word of the course's row, for updating.
+uint64_t* EnrollmentBitmap::row(int courseId) {
+    return bits.data() + static_cast<size_t>(courseId) * words;
+}
+
+// Precondition: The caller holds `columnsLock` exclusively (or no other thread can reach the bitmap).
+// Postcondition: Every row has room for at least `columnCount` columns and true is returned; rows grow by at
+// least half so widening stays rare. Returns false, leaving the rows as they were, if that would exceed maxBytes.
+bool EnrollmentBitmap::widen(size_t columnCount) {
+    size_t needed = (columnCount + 63) / 64;
+    if (needed <= words) return true;
+    size_t wider = max(needed, words + words / 2);
+    if (static_cast<size_t>(courseCount) * wider * sizeof(uint64_t) > maxBytes) {
+        wider = needed;
+        if (static_cast<size_t>(courseCount) * wider * sizeof(uint64_t) > maxBytes)
+            return false;
+    }
+    vector<uint64_t> larger(static_cast<size_t>(courseCount) * wider, 0);
+    for (int i = 0; i < courseCount; i++)
+        copy(row(i), row(i) + words, larger.begin() + static_cast<size_t>(i) * wider);
+    bits.swap(larger);
+    words = wider;
+    return true;
+}
+
+// Precondition: The caller holds `columnsLock` exclusively (or no other thread can reach the bitmap).
+// Postcondition: Returns the student's column, adding one if needed, or NO_COLUMN if the rows cannot grow;
+// in that case the bitmap stops tracking and isValid() turns false.
+uint32_t EnrollmentBitmap::addColumn(const Student* student) {
+    auto found = columns.find(student);
+    if (found != columns.end()) return found->second;
+    if (!widen(students.size() + 1)) {
+        valid.store(false);
+        return NO_COLUMN;
+    }
+    uint32_t column = static_cast<uint32_t>(students.size());
+    students.push_back(student);
+    columns.emplace(student, column);
+    return column;
+}
+
+// Member function
+// Precondition: `courseList` points to `courseCount` valid Course objects and no transaction is running.
+// `studentCount` is the number of students expected (room is made for a quarter more).
+// Postcondition: Fills one row per course from its roster and waitlist, attaches the bitmap to every course
+// so later changes are mirrored, and returns true. Returns false (and attaches nothing) if the rows would
+// need more than maxBytes.
+bool EnrollmentBitmap::build(Course* courseList, int courseCount, int studentCount) {
+    unique_lock<shared_mutex> writer(columnsLock);
+    this->courseCount = courseCount;
+    size_t columnCount = static_cast<size_t>(studentCount) + studentCount / 4 + 64;
+    if (bytesFor(courseCount, static_cast<int>(min<size_t>(columnCount, INT32_MAX))) > maxBytes) {
+        if (bytesFor(courseCount, studentCount) > maxBytes) return false;
+        columnCount = studentCount;
+    }
+    words = (columnCount + 63) / 64;
+    bits.assign(static_cast<size_t>(courseCount) * words, 0);
+    rowLocks.reset(new SpinLock[max(1, courseCount)]);
+    columns.clear();
+    columns.reserve(studentCount);
+    students.clear();
+    students.reserve(columnCount);
+    valid.store(true);
+    for (int i = 0; i < courseCount; i++) {
+        vector<Student*> members = courseList[i].getWaitList().getStudents();
+        const vector<Student*>& enrolled = courseList[i].getRoster().getItems();
+        members.insert(members.end(), enrolled.begin(), enrolled.end());
+        for (const Student* student : members) {
+            uint32_t column = addColumn(student);
+            if (column == NO_COLUMN) return false;
+            row(i)[column / 64] |= uint64_t(1) << (column % 64);
+        }
+    }
+    for (int i = 0; i < courseCount; i++)
+        courseList[i].attachBitmap(this);
+    return true;
+}
+
+// Precondition: The caller holds the course's lock, so changes to one course are not concurrent.
+// Postcondition: The student's bit in the course's row is set if `member`, cleared otherwise.
+void EnrollmentBitmap::set(int courseId, const Student* student, bool member) {
+    if (!valid.load(memory_order_relaxed)) return;
+    {
+        shared_lock<shared_mutex> reader(columnsLock);
+        auto found = columns.find(student);
+        if (found != columns.end()) {
+            uint32_t column = found->second;
+            lock_guard<SpinLock> guard(rowLocks[courseId]);
+            uint64_t& word = row(courseId)[column / 64];
+            if (member)
+                word |= uint64_t(1) << (column % 64);
+            else
+                word &= ~(uint64_t(1) << (column % 64));
+            return;
+        }
+        if (!member) return;
+    }
+    // A student the bitmap has not seen yet: every row may have to widen
+    unique_lock<shared_mutex> writer(columnsLock);
+    uint32_t column = addColumn(student);
+    if (column != NO_COLUMN)
+        row(courseId)[column / 64] |= uint64_t(1) << (column % 64);
+}
+
+// Getter
+// Precondition: None.
+// Postcondition: Returns true while the bitmap mirrors the courses; false before build() succeeds or after
+// the rows hit the memory limit, in which case callers must fall back to the rosters.
+bool EnrollmentBitmap::isValid() const {
+    return valid.load();
+}
+
+// Precondition: `first` and `second` are valid course ids.
+// Postcondition: Returns the size of the intersection (or union) of the two rows.
+size_t EnrollmentBitmap::countPair(int first, int second, bool unite) const {
+    shared_lock<shared_mutex> reader(columnsLock);
+    RowGuard guard(rowLocks.get(), first, second);
+    CountKernel kernel = unite ? kernels.unite : kernels.intersect;
+    return kernel(row(first), row(second), words);
+}
+
+// Precondition: `first` and `second` are valid course ids.
+// Postcondition: Returns the students in both rows (or either row), in column order.
+vector<const Student*> EnrollmentBitmap::collect(int first, int second, bool unite) const {
+    shared_lock<shared_mutex> reader(columnsLock);
+    RowGuard guard(rowLocks.get(), first, second);
+    vector<const Student*> result;
+    const uint64_t* a = row(first);
+    const uint64_t* b = row(second);
+    for (size_t i = 0; i < words; i++) {
+        uint64_t word = unite ? a[i] | b[i] : a[i] & b[i];
+        while (word != 0) {
+            result.push_back(students[i * 64 + __builtin_ctzll(word)]);
+            word &= word - 1;
+        }
+    }
+    return result;
+}
+
+// Member function
+// Precondition: 0 <= `courseId` < the number of courses built.
+// Postcondition: Returns the number of students enrolled in or waiting for the course.
+size_t EnrollmentBitmap::count(int courseId) const {
+    return countPair(courseId, courseId, false);
+}
+
+// Precondition: `first` and `second` are valid course ids.
+// Postcondition: Returns how many students are in both courses.
+size_t EnrollmentBitmap::intersectionCount(int first, int second) const {
+    return countPair(first, second, false);
+}
+
+// Precondition: `first` and `second` are valid course ids.
+// Postcondition: Returns how many students are in at least one of the courses.
+size_t EnrollmentBitmap::unionCount(int first, int second) const {
+    return countPair(first, second, true);
+}
+
+// Precondition: `first` and `second` are valid course ids.
+// Postcondition: Returns the students who are in both courses.
+vector<const Student*> EnrollmentBitmap::intersection(int first, int second) const {
+    return collect(first, second, false);
+}
+
+// Precondition: `first` and `second` are valid course ids.
+// Postcondition: Returns the students who are in at least one of the courses.
+vector<const Student*> EnrollmentBitmap::unionOf(int first, int second) const {
+    return collect(first, second, true);
+}
+
+// Getter
+// Precondition: None.
+// Postcondition: Returns the bytes held by the rows and the column tables.
+size_t EnrollmentBitmap::memoryBytes() const {
+    shared_lock<shared_mutex> reader(columnsLock);
+    return bits.capacity() * sizeof(uint64_t) + students.capacity() * sizeof(const Student*)
+           + columns.size() * (sizeof(void*) * 2 + sizeof(uint32_t) + sizeof(void*)) + columns.bucket_count() * sizeof(void*);
+}
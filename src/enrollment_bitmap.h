@@ -0,0 +1,62 @@
+#ifndef ENROLLMENT_BITMAP_H
+#define ENROLLMENT_BITMAP_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "course_registration.h"
+#include "spin_lock.h"
+using namespace std;
+
+// Optional student x course membership index for overlap queries ("who is in both CIS042 and CS031?").
+// Every course owns one bit row with one bit per student column; a bit is set while the student is
+// enrolled in or waiting for the course. Courses report every change through set(), so the rows stay in
+// step with the rosters and waitlists. Intersection, union and population counts run word by word with
+// the widest kernel the CPU supports (AVX2, then SSE4.2 with POPCNT, then portable scalar code).
+//
+// Locking: set() and the queries hold `columnsLock` shared plus the spin lock of every row they touch
+// (rows in ascending course order); adding a student column takes `columnsLock` exclusively, because it
+// may have to widen every row.
+class EnrollmentBitmap {
+private:
+    int courseCount;
+    size_t words;                           // 64-bit words per row
+    vector<uint64_t> bits;                  // courseCount rows of `words` words each
+    unique_ptr<SpinLock[]> rowLocks;
+    unordered_map<const Student*, uint32_t> columns;
+    vector<const Student*> students;        // column -> student
+    mutable shared_mutex columnsLock;
+    size_t maxBytes;
+    atomic<bool> valid;
+
+    const uint64_t* row(int courseId) const;
+    uint64_t* row(int courseId);
+    bool widen(size_t columnCount);
+    uint32_t addColumn(const Student* student);
+    vector<const Student*> collect(int first, int second, bool unite) const;
+    size_t countPair(int first, int second, bool unite) const;
+public:
+    static const size_t DEFAULT_MAX_BYTES = size_t(1) << 30;
+    EnrollmentBitmap(size_t byteLimit = DEFAULT_MAX_BYTES);
+    EnrollmentBitmap(const EnrollmentBitmap&) = delete;
+    EnrollmentBitmap& operator=(const EnrollmentBitmap&) = delete;
+    static size_t bytesFor(int courseCount, int studentCount);
+    static const char* kernelName();
+    static bool useKernel(const string& name);
+    bool build(Course* courseList, int courseCount, int studentCount);
+    void set(int courseId, const Student* student, bool member);
+    bool isValid() const;
+    size_t count(int courseId) const;
+    size_t intersectionCount(int first, int second) const;
+    size_t unionCount(int first, int second) const;
+    vector<const Student*> intersection(int first, int second) const;
+    vector<const Student*> unionOf(int first, int second) const;
+    size_t memoryBytes() const;
+};
+
+#endif //ENROLLMENT_BITMAP_H
@@ -0,0 +1,384 @@
+// Course Registration System
+// Author: Sherry Shi
+// Description: Entry point: loads the data files and runs the interactive menu,
+// replays a command file with --batch, dumps every roster with --report, or serves clients on a
+// local socket with --serve (or spread over shard worker processes with --route), or summarizes enrollment
+// with --analytics; --state keeps registrations across restarts.
+// Date: 10-11-2024
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <unistd.h>
+#include "analytics.h"
+#include "batch.h"
+#include "course_registration.h"
+#include "course_index.h"
+#include "engine.h"
+#include "enrollment_bitmap.h"
+#include "metrics.h"
+#include "persistence.h"
+#include "report.h"
+#include "router.h"
+#include "server.h"
+#include "shard_catalog.h"
+#include "snapshot.h"
+#include "student_registry.h"
+
+using namespace std;
+
+// Precondition: None.
+// Postcondition: Prints the command-line usage to stderr.
+static void printUsage(const char* program) {
+    cerr << "Usage: " << program << " [--state <dir>] [--policy <name>]    (interactive menu)" << endl;
+    cerr << "       " << program << " --batch <course file> <enrollment file> [command file | -]"
+         << " [--threads <n>] [--state <dir>] [--metrics] [--bitmap] [--policy <name>]" << endl;
+    cerr << "       " << program << " --report <course file> <enrollment file> [output file | -]"
+         << " [--format text|csv|tsv] [--threads <n>] [--state <dir>]" << endl;
+    cerr << "       " << program << " --serve <course file> <enrollment file> (--unix <path> | --tcp <port>)"
+         << " [--threads <n>] [--state <dir>] [--metrics] [--bitmap] [--policy <name>]" << endl;
+    cerr << "       " << program << " --route <course file> <enrollment file> --shards <n>"
+         << " (--unix <path> | --tcp <port>) [--threads <n>] [--state <dir>] [--metrics] [--bitmap]"
+         << " [--policy <name>]" << endl;
+    cerr << "       " << program << " --analytics <course file> <enrollment file> [--source memory|file]"
+         << " [--top <n>] [--per-course] [--threads <n>] [--state <dir>]" << endl;
+    cerr << "--policy picks who leaves a waitlist first: fifo (arrival order, the default) or seniority" << endl;
+    cerr << "(lowest student id first; equal ranks keep arrival order)." << endl;
+    cerr << "With --state, registrations are saved in <dir> and reloaded on the next start;" << endl;
+    cerr << "the course and enrollment files are only read while <dir> has no snapshot yet." << endl;
+    cerr << "Saved state keeps its waitlist policy unless a later run names another with --policy." << endl;
+    cerr << "--route starts one worker process per shard (each with its own <dir>/shard<i> state) and" << endl;
+    cerr << "routes every request to the shards that own its courses." << endl;
+    if (METRICS_ENABLED)
+        cerr << "Send SIGUSR1 (kill -USR1 <pid>) to print operation metrics to stderr at any time." << endl;
+}
+
+int main(int argc, char* argv[]) {
+
+    // Batch mode reads its commands from a file (or stdin) instead of the menu;
+    // report mode writes the full enrollment listing to a file (or stdout) and exits;
+    // serve mode answers the same commands from clients on a local socket;
+    // route mode serves them through one worker process per shard of the catalog, each started by the router
+    // in worker mode (--shard-worker <segment> <shard> <enrollment file>) and serving only its own courses;
+    // analytics mode prints fill rates, waitlist pressure and oversubscribed courses and exits
+    bool batchMode = argc > 1 && strcmp(argv[1], "--batch") == 0;
+    bool reportMode = argc > 1 && strcmp(argv[1], "--report") == 0;
+    bool routeMode = argc > 1 && strcmp(argv[1], "--route") == 0;
+    bool workerMode = argc > 1 && strcmp(argv[1], "--shard-worker") == 0;
+    bool serveMode = (argc > 1 && strcmp(argv[1], "--serve") == 0) || workerMode;
+    bool analyticsMode = argc > 1 && strcmp(argv[1], "--analytics") == 0;
+    bool fileMode = batchMode || reportMode || serveMode || routeMode || analyticsMode;
+
+    // Let the server see SIGINT/SIGTERM and kill -USR1 print the metrics; must run before any other thread starts
+    if (serveMode || routeMode)
+        RegistrationServer::blockStopSignals();
+    if (METRICS_ENABLED)
+        Metrics::dumpOnSignal();
+
+    vector<string> positional;
+    int threadCount = batchMode || serveMode ? 1 : max(1u, thread::hardware_concurrency());
+    ReportFormat format = ReportFormat::TEXT;
+    string stateDirectory;
+    bool printMetrics = false;
+    bool useBitmap = false;
+    const PromotionPolicy* policy = nullptr;    // set by --policy; otherwise fifo, or the saved state's policy
+    bool fromFile = false;
+    int topCount = 10;
+    bool perCourse = false;
+    string socketPath;
+    int port = 0;
+    int shardCount = 0;
+    vector<string> workerOptions;       // route mode: passed on to every shard worker
+    bool badOption = false;
+    for (int i = fileMode ? 2 : 1; i < argc; i++) {
+        if (routeMode && i + 1 < argc && (strcmp(argv[i], "--threads") == 0 || strcmp(argv[i], "--policy") == 0)) {
+            bool isPolicy = strcmp(argv[i], "--policy") == 0;
+            workerOptions.push_back(argv[i]);
+            workerOptions.push_back(argv[++i]);
+            badOption = (isPolicy && PromotionPolicy::find(argv[i]) == nullptr) || badOption;
+        }
+        else if (routeMode && (strcmp(argv[i], "--metrics") == 0 || strcmp(argv[i], "--bitmap") == 0))
+            workerOptions.push_back(argv[i]);
+        else if (strcmp(argv[i], "--shards") == 0 && routeMode && i + 1 < argc)
+            shardCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && fileMode && i + 1 < argc)
+            threadCount = max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--format") == 0 && reportMode && i + 1 < argc)
+            badOption = !parseReportFormat(argv[++i], format) || badOption;
+        else if (strcmp(argv[i], "--metrics") == 0 && (batchMode || serveMode))
+            printMetrics = true;
+        else if (strcmp(argv[i], "--bitmap") == 0 && (batchMode || serveMode))
+            useBitmap = true;
+        else if (strcmp(argv[i], "--policy") == 0 && !reportMode && !analyticsMode && i + 1 < argc)
+            badOption = (policy = PromotionPolicy::find(argv[++i])) == nullptr || badOption;
+        else if (strcmp(argv[i], "--source") == 0 && analyticsMode && i + 1 < argc) {
+            fromFile = strcmp(argv[++i], "file") == 0;
+            badOption = (!fromFile && strcmp(argv[i], "memory") != 0) || badOption;
+        }
+        else if (strcmp(argv[i], "--top") == 0 && analyticsMode && i + 1 < argc)
+            topCount = max(0, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--per-course") == 0 && analyticsMode)
+            perCourse = true;
+        else if (strcmp(argv[i], "--unix") == 0 && (serveMode || routeMode) && i + 1 < argc)
+            socketPath = argv[++i];
+        else if (strcmp(argv[i], "--tcp") == 0 && (serveMode || routeMode) && i + 1 < argc)
+            port = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--state") == 0 && i + 1 < argc)
+            stateDirectory = argv[++i];
+        else if (fileMode && (argv[i][0] != '-' || strcmp(argv[i], "-") == 0))
+            positional.push_back(argv[i]);
+        else
+            badOption = true;
+    }
+    if ((serveMode || routeMode)
+        && (positional.size() != (workerMode ? 3u : 2u) || socketPath.empty() == (port == 0) || port < 0 || port > 65535))
+        badOption = true;
+    if (routeMode && (shardCount < 1 || shardCount > 1024))
+        badOption = true;
+    // The file source reads the enrollment file itself, so there is no saved state to start from
+    if (analyticsMode && (positional.size() != 2 || (fromFile && !stateDirectory.empty())))
+        badOption = true;
+    if (badOption || (fileMode && (positional.size() < 2 || positional.size() > 3))) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // Straight from the files: only the course list is loaded, and the enrollment file becomes columns directly
+    if (analyticsMode && fromFile) {
+        vector<Course> catalog = readFile1(positional[0]);
+        CourseIndex catalogIndex(catalog.data(), static_cast<int>(catalog.size()));
+        auto started = chrono::steady_clock::now();
+        EnrollmentColumns columns;
+        if (!columnsFromFile(positional[1], catalogIndex, columns, threadCount)) {
+            cerr << "Input file opening failed." << endl;
+            return 1;
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+        return runAnalytics(columns, seconds, catalog.data(), topCount, perCourse, stdout, threadCount) ? 0 : 1;
+    }
+
+    // The router only holds the catalog; the workers it starts load the rosters and answer the requests
+    if (routeMode) {
+        vector<Course> catalogCourses = readFile1(positional[0]);
+        ShardCatalog catalog;
+        string segmentName = "/registration-" + to_string(getpid());
+        if (!catalog.create(segmentName, catalogCourses.data(), static_cast<int>(catalogCourses.size()), shardCount))
+            return 1;
+        catalogCourses.clear();
+        ShardRouter router(catalog);
+        if (!router.startWorkers(segmentName, positional[1], stateDirectory, workerOptions))
+            return 1;
+        // Every worker has mapped the catalog by now
+        catalog.unlinkName();
+        bool listening = socketPath.empty() ? router.listenTcp(port) : router.listenUnix(socketPath);
+        if (!listening)
+            return 1;
+        cerr << "Routing " << catalog.getCourseCount() << " courses over " << shardCount << " shards on "
+             << (socketPath.empty() ? "127.0.0.1:" + to_string(port) : socketPath) << "; stop with Ctrl-C." << endl;
+        bool stopped = router.run();
+        router.stopWorkers();
+        return stopped ? 0 : 1;
+    }
+
+    // A shard worker takes its courses from the router's shared catalog instead of the course file
+    ShardCatalog sharedCatalog;
+    int shard = 0;
+    if (workerMode) {
+        shard = atoi(positional[1].c_str());
+        if (!sharedCatalog.attach(positional[0]))
+            return 1;
+        if (shard < 0 || shard >= sharedCatalog.getShardCount()) {
+            cerr << "The catalog has no shard " << positional[1] << "." << endl;
+            return 1;
+        }
+    }
+
+    // All student records are owned here and released together on exit
+    StudentRegistry registry;
+    vector<Course> courses;
+
+    // With durable state, a saved snapshot replaces the text files
+    unique_ptr<DurableState> state;
+    bool restored = false;
+    if (!stateDirectory.empty())
+        state.reset(new DurableState(stateDirectory));
+    if (state != nullptr && state->hasSnapshot()) {
+        restored = true;
+        if (!state->loadSnapshot(courses, registry)) {
+            cerr << "Snapshot in " << stateDirectory << " is damaged or in an older format." << endl;
+            return 1;
+        }
+        if (workerMode && !sharedCatalog.matchesShard(shard, courses.data(), static_cast<int>(courses.size()))) {
+            cerr << "Snapshot in " << stateDirectory << " was saved for a different shard layout." << endl;
+            return 1;
+        }
+    } else if (workerMode) {
+        // Only students with a course in this shard get a record
+        courses = sharedCatalog.shardCourses(shard);
+        CourseIndex shardIndex(courses.data(), static_cast<int>(courses.size()));
+        readFile2(positional[2], courses.data(), shardIndex, registry, 0, true);
+    } else {
+        string filename1, filename2;
+        if (fileMode) {
+            filename1 = positional[0];
+            filename2 = positional[1];
+        } else {
+            cout << "Enter course filename : ";
+            cin >> filename1;
+            cout << "Enter enrollment filename : ";
+            cin >> filename2;
+            cout << endl;
+        }
+        // Read file1 and save data to a dynamic array
+        courses = readFile1(filename1);
+        CourseIndex fileIndex(courses.data(), static_cast<int>(courses.size()));
+        // Read file2 and link each student into the course rosters and waitlists
+        readFile2(filename2, courses.data(), fileIndex, registry);
+    }
+    Course* courseList = courses.data();
+    int courseCount = static_cast<int>(courses.size());
+    // Index the course codes once so every lookup below is a hash probe
+    CourseIndex index(courseList, courseCount);
+    if (METRICS_ENABLED)
+        Metrics::trackCourses(courseList, courseCount);
+    // Waitlists are ranked before the log is replayed, so replayed promotions follow the same policy.
+    // A restored snapshot already carries the policy its log was written under.
+    if (!restored && policy != nullptr)
+        for (int i = 0; i < courseCount; i++)
+            courseList[i].setPromotionPolicy(*policy);
+
+    // Bring the state up to date with the log and start logging every change
+    RegistrationEngine engine(courseList, index, registry, batchMode || serveMode ? threadCount : 1);
+    if (state != nullptr) {
+        if (!state->open(courseList, courseCount, index, registry)) {
+            cerr << "State directory " << stateDirectory << " cannot be written." << endl;
+            return 1;
+        }
+        // A restored state switches to an explicit --policy only now, and the checkpoint saves the switch
+        // before anything is logged under it. Report and analytics runs never take --policy, so they
+        // leave the saved state as it is.
+        if (restored && policy != nullptr) {
+            for (int i = 0; i < courseCount; i++)
+                courseList[i].setPromotionPolicy(*policy);
+            if (!state->checkpoint()) {
+                cerr << "State directory " << stateDirectory << " cannot be written." << endl;
+                return 1;
+            }
+        }
+        engine.attach(state.get());
+    }
+
+    // The optional membership bitmap answers OVERLAP queries with vectorized row operations
+    unique_ptr<EnrollmentBitmap> bitmap;
+    if (useBitmap) {
+        bitmap.reset(new EnrollmentBitmap());
+        if (!bitmap->build(courseList, courseCount, registry.size())) {
+            cerr << "The enrollment bitmap would need "
+                 << EnrollmentBitmap::bytesFor(courseCount, registry.size()) / (1 << 20) << " MiB (limit "
+                 << EnrollmentBitmap::DEFAULT_MAX_BYTES / (1 << 20) << " MiB); OVERLAP uses the rosters instead." << endl;
+            bitmap.reset();
+        }
+    }
+
+    if (reportMode) {
+        FILE* output = stdout;
+        if (positional.size() == 3 && positional[2] != "-") {
+            output = fopen(positional[2].c_str(), "w");
+            if (output == nullptr) {
+                cerr << "Output file opening failed." << endl;
+                return 1;
+            }
+        }
+        bool written = writeReport(courseList, courseCount, format, output, threadCount);
+        if (output != stdout)
+            written = fclose(output) == 0 && written;
+        if (!written)
+            cerr << "The report could not be written." << endl;
+        return written ? 0 : 1;
+    }
+
+    if (analyticsMode) {
+        auto started = chrono::steady_clock::now();
+        EnrollmentColumns columns;
+        columnsFromCourses(courseList, courseCount, registry.size(), columns, threadCount);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+        return runAnalytics(columns, seconds, courseList, topCount, perCourse, stdout, threadCount) ? 0 : 1;
+    }
+
+    if (serveMode) {
+        // Reports are rendered from published snapshots while registrations go on
+        SnapshotStore snapshots(courseList, courseCount);
+        engine.attach(&snapshots);
+        RegistrationServer server(engine, snapshots, courseList, courseCount, index);
+        bool listening = socketPath.empty() ? server.listenTcp(port) : server.listenUnix(socketPath);
+        if (!listening)
+            return 1;
+        cerr << (workerMode ? "Shard " + positional[1] + ": serving " : "Serving ") << courseCount << " courses on "
+             << (socketPath.empty() ? "127.0.0.1:" + to_string(port) : socketPath) << "; stop with Ctrl-C." << endl;
+        server.run();
+        if (printMetrics)
+            Metrics::dump(stderr);
+        if (state != nullptr)
+            state->checkpoint();
+        return 0;
+    }
+
+    if (batchMode) {
+        FILE* commands = stdin;
+        if (positional.size() == 3 && positional[2] != "-") {
+            commands = fopen(positional[2].c_str(), "r");
+            if (commands == nullptr) {
+                cerr << "Input file opening failed." << endl;
+                return 1;
+            }
+        }
+        int errors = runBatch(commands, engine, courseList, stdout);
+        if (commands != stdin)
+            fclose(commands);
+        if (printMetrics)
+            Metrics::dump(stderr);
+        if (state != nullptr)
+            state->checkpoint();
+        return errors == 0 ? 0 : 2;
+    }
+
+    // Show the menu; option 4 re-renders only the courses changed since it last ran
+    ReportCache reportCache(ReportFormat::TEXT);
+    int select;
+    do{
+        cout << "================= MENU =================" << endl;
+        cout << "  1. View your registration" << endl;
+        cout << "  2. Course registration" << endl;
+        cout << "  3. Course cancellation" << endl;
+        cout << "  4. Print enrollment list including waitlist" << endl;
+        cout << "  5. Exit" << endl;
+        if (METRICS_ENABLED)
+            cout << "  6. Show metrics" << endl;
+        cout << "  ---> Select : ";
+        cin >> select;
+        cout << endl;
+        if(select == 1)
+            menu1(courseList, registry);
+        else if(select == 2)
+            menu2(courseList, index, engine);
+        else if(select == 3)
+            menu3(courseList, index, engine);
+        else if(select == 4)
+            menu4(courseList, courseCount, reportCache);
+        else if(select == 6 && METRICS_ENABLED){
+            cout.flush();
+            Metrics::dump(stdout);
+            cout << endl;
+        }
+    }while(select != 5);
+
+    // Save a fresh snapshot so the next start does not need to replay the log
+    if (state != nullptr)
+        state->checkpoint();
+    return 0;
+}
@@ -0,0 +1,119 @@
+// Memory-mapped file access and a minimal field scanner for the text data files.
+
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "mapped_file.h"
+
+using namespace std;
+
+// MappedFile class
+// Constructor
+// Precondition: None.
+// Postcondition: If `filename` can be opened, its contents are mapped read-only and isOpen() returns true.
+// An empty file is treated as successfully opened with size() == 0.
+MappedFile::MappedFile(const string& filename) : data(nullptr), length(0), opened(false) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat info;
+    if (fstat(fd, &info) == 0) {
+        length = static_cast<size_t>(info.st_size);
+        if (length == 0) {
+            opened = true;
+        } else {
+            void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                madvise(mapped, length, MADV_SEQUENTIAL);
+                data = static_cast<const char*>(mapped);
+                opened = true;
+            }
+        }
+    }
+    close(fd);
+}
+
+// Destructor
+// Precondition: None.
+// Postcondition: The mapping, if any, is released.
+MappedFile::~MappedFile() {
+    if (data != nullptr)
+        munmap(const_cast<char*>(data), length);
+}
+
+// Getter
+// Precondition: None.
+// Postcondition: Returns true if the file was opened and mapped.
+bool MappedFile::isOpen() const { return opened; }
+
+// Precondition: None.
+// Postcondition: Returns a pointer to the first byte of the file (nullptr for an empty file).
+const char* MappedFile::begin() const { return data; }
+
+// Precondition: None.
+// Postcondition: Returns a pointer one past the last byte of the file.
+const char* MappedFile::end() const { return data + length; }
+
+// Precondition: None.
+// Postcondition: Returns the file size in bytes.
+size_t MappedFile::size() const { return length; }
+
+// LineScanner class
+// Constructor
+// Precondition: [`first`, `last`) is a readable buffer.
+// Postcondition: The scanner is positioned before the first line.
+LineScanner::LineScanner(const char* first, const char* last)
+        : cursor(first), bufferEnd(last), lineEnd(first), lineNumber(0) {}
+
+// Member function
+// Precondition: None.
+// Postcondition: Advances to the next line and returns true, or returns false at the end of the buffer.
+// Any unread fields of the previous line are skipped.
+bool LineScanner::nextLine() {
+    if (lineNumber > 0)
+        cursor = lineEnd < bufferEnd ? lineEnd + 1 : bufferEnd;
+    if (cursor >= bufferEnd) return false;
+    const char* newline = static_cast<const char*>(memchr(cursor, '\n', bufferEnd - cursor));
+    lineEnd = newline != nullptr ? newline : bufferEnd;
+    lineNumber++;
+    return true;
+}
+
+// Precondition: nextLine() returned true.
+// Postcondition: Returns true and sets [`fieldBegin`, `fieldEnd`) to the next field on the current line,
+// or returns false if the line has no more fields.
+bool LineScanner::nextField(const char*& fieldBegin, const char*& fieldEnd) {
+    while (cursor < lineEnd && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r'))
+        cursor++;
+    if (cursor == lineEnd) return false;
+    fieldBegin = cursor;
+    while (cursor < lineEnd && *cursor != ' ' && *cursor != '\t' && *cursor != '\r')
+        cursor++;
+    fieldEnd = cursor;
+    return true;
+}
+
+// Precondition: nextLine() returned true.
+// Postcondition: Returns true and stores the next field in `value` if it is a complete integer, otherwise false.
+bool LineScanner::nextInt(int& value) {
+    const char* fieldBegin;
+    const char* fieldEnd;
+    if (!nextField(fieldBegin, fieldEnd)) return false;
+    from_chars_result result = from_chars(fieldBegin, fieldEnd, value);
+    return result.ec == errc() && result.ptr == fieldEnd;
+}
+
+// Precondition: nextLine() returned true.
+// Postcondition: Returns true if only whitespace remains on the current line.
+bool LineScanner::atLineEnd() {
+    while (cursor < lineEnd && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r'))
+        cursor++;
+    return cursor == lineEnd;
+}
+
+// Getter
+// Precondition: None.
+// Postcondition: Returns the 1-based number of the current line (0 before the first nextLine()).
+int LineScanner::getLineNumber() const { return lineNumber; }
@@ -0,0 +1,43 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+using namespace std;
+
+// Read-only view of a whole file mapped into memory.
+// The mapping is released when the object goes out of scope.
+class MappedFile {
+private:
+    const char* data;
+    size_t length;
+    bool opened;
+public:
+    MappedFile(const string& filename);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    bool isOpen() const;
+    const char* begin() const;
+    const char* end() const;
+    size_t size() const;
+};
+
+// Walks a buffer line by line and splits each line into whitespace-separated fields.
+// Tracks the 1-based line number so loaders can report where a bad row is.
+class LineScanner {
+private:
+    const char* cursor;
+    const char* bufferEnd;
+    const char* lineEnd;
+    int lineNumber;
+public:
+    LineScanner(const char* first, const char* last);
+    bool nextLine();
+    bool nextField(const char*& fieldBegin, const char*& fieldEnd);
+    bool nextInt(int& value);
+    bool atLineEnd();
+    int getLineNumber() const;
+};
+
+#endif //MAPPED_FILE_H
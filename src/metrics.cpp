@@ -0,0 +1,271 @@
+// Low-overhead instrumentation: thread-local counters and latency histograms, merged when dumped.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "metrics.h"
+
+using namespace std;
+
+static const int OPS = static_cast<int>(TimedOp::COUNT);
+static const int COUNTERS = static_cast<int>(Counter::COUNT);
+
+// One thread's metrics. Only the owning thread writes them, so an update is a relaxed load and store
+// (a plain add, no locked instruction); atomics only make the concurrent read by dump() well defined.
+struct ThreadMetrics {
+    atomic<uint64_t> counters[COUNTERS];
+    atomic<uint64_t> calls[OPS];
+    atomic<uint64_t> samples[OPS];
+    atomic<uint64_t> totalTicks[OPS];
+    atomic<uint64_t> maxTicks[OPS];
+    atomic<uint64_t> buckets[OPS][LatencyHistogram::BUCKETS];
+};
+
+// Precondition: Only the calling thread writes `value`.
+// Postcondition: `value` is increased by `amount`.
+static inline void bump(atomic<uint64_t>& value, uint64_t amount) {
+    value.store(value.load(memory_order_relaxed) + amount, memory_order_relaxed);
+}
+
+// Precondition: None.
+// Postcondition: Every metric in `from` is added to `to`.
+static void mergeInto(ThreadMetrics& to, const ThreadMetrics& from) {
+    for (int i = 0; i < COUNTERS; i++)
+        bump(to.counters[i], from.counters[i].load(memory_order_relaxed));
+    for (int op = 0; op < OPS; op++) {
+        bump(to.calls[op], from.calls[op].load(memory_order_relaxed));
+        bump(to.samples[op], from.samples[op].load(memory_order_relaxed));
+        bump(to.totalTicks[op], from.totalTicks[op].load(memory_order_relaxed));
+        to.maxTicks[op].store(max(to.maxTicks[op].load(memory_order_relaxed),
+                                  from.maxTicks[op].load(memory_order_relaxed)), memory_order_relaxed);
+        for (int b = 0; b < LatencyHistogram::BUCKETS; b++)
+            bump(to.buckets[op][b], from.buckets[op][b].load(memory_order_relaxed));
+    }
+}
+
+// Every live thread's metrics, plus the totals of threads that have exited
+static mutex registryLock;
+static vector<ThreadMetrics*> liveThreads;
+static ThreadMetrics retiredThreads;
+
+// Registers the thread's metrics on first use and folds them into the retired totals when the thread exits.
+struct ThreadSlot {
+    ThreadMetrics* metrics;
+    int untilSample[OPS] = {};     // calls left before the next sampled one; the first call is sampled
+    ThreadSlot() : metrics(new ThreadMetrics()) {
+        lock_guard<mutex> guard(registryLock);
+        liveThreads.push_back(metrics);
+    }
+    ~ThreadSlot() {
+        lock_guard<mutex> guard(registryLock);
+        mergeInto(retiredThreads, *metrics);
+        liveThreads.erase(find(liveThreads.begin(), liveThreads.end(), metrics));
+        delete metrics;
+    }
+};
+static thread_local ThreadSlot slot;
+
+// Waitlist gauges, indexed by course id; set up once by trackCourses()
+static const Course* gaugeCourses = nullptr;
+static unique_ptr<atomic<int>[]> currentWait;
+static unique_ptr<atomic<int>[]> peakWait;
+static atomic<int> gaugeCount(0);
+
+// Reference points for converting timestamp ticks to nanoseconds
+static const uint64_t startTicks = Metrics::now();
+static const chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+
+// LatencyHistogram class
+// Precondition: None.
+// Postcondition: Returns the bucket holding `value`. Values below SUB_BUCKETS get a bucket each; above that,
+// a bucket covers 1/SUB_BUCKETS of its power of two.
+int LatencyHistogram::bucketOf(uint64_t value) {
+    if (value < SUB_BUCKETS)
+        return static_cast<int>(value);
+    int shift = 63 - __builtin_clzll(value) - SUB_BITS;
+    return (shift + 1) * SUB_BUCKETS + static_cast<int>((value >> shift) - SUB_BUCKETS);
+}
+
+// Precondition: 0 <= `bucket` < BUCKETS.
+// Postcondition: Returns the midpoint of the values that fall in `bucket`.
+uint64_t LatencyHistogram::bucketValue(int bucket) {
+    int group = bucket / SUB_BUCKETS;
+    uint64_t sub = bucket % SUB_BUCKETS;
+    if (group == 0)
+        return sub;
+    int shift = group - 1;
+    return ((SUB_BUCKETS + sub) << shift) + ((uint64_t(1) << shift) >> 1);
+}
+
+// Metrics class
+// Precondition: None.
+// Postcondition: Returns a timestamp in ticks: the CPU timestamp counter where available, otherwise nanoseconds.
+uint64_t Metrics::now() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Precondition: None.
+// Postcondition: Counts one call of `op`. Returns the current timestamp if this call is to be timed
+// (the first call on each thread and every SAMPLE_EVERY-th after it), otherwise 0.
+uint64_t Metrics::begin(TimedOp op) {
+    int index = static_cast<int>(op);
+    bump(slot.metrics->calls[index], 1);
+    if (--slot.untilSample[index] > 0)
+        return 0;
+    slot.untilSample[index] = SAMPLE_EVERY;
+    return now();
+}
+
+// Precondition: `start` was returned by begin() on this thread.
+// Postcondition: The time since `start` is recorded as one sample of `op` in this thread's histogram.
+void Metrics::record(TimedOp op, uint64_t start) {
+    uint64_t ticks = now() - start;
+    ThreadMetrics& metrics = *slot.metrics;
+    int index = static_cast<int>(op);
+    bump(metrics.samples[index], 1);
+    bump(metrics.totalTicks[index], ticks);
+    if (ticks > metrics.maxTicks[index].load(memory_order_relaxed))
+        metrics.maxTicks[index].store(ticks, memory_order_relaxed);
+    bump(metrics.buckets[index][LatencyHistogram::bucketOf(ticks)], 1);
+}
+
+// Precondition: None.
+// Postcondition: `counter` is increased by one in this thread's block.
+void Metrics::count(Counter counter) {
+    bump(slot.metrics->counters[static_cast<int>(counter)], 1);
+}
+
+// Precondition: `courseList` points to `courseCount` Course objects that outlive the metrics, and no
+// transaction is running. Call once, after the courses are loaded.
+// Postcondition: The waitlist gauges start from the courses' current waitlist lengths.
+void Metrics::trackCourses(const Course* courseList, int courseCount) {
+    currentWait.reset(new atomic<int>[courseCount]);
+    peakWait.reset(new atomic<int>[courseCount]);
+    for (int i = 0; i < courseCount; i++) {
+        currentWait[i].store(courseList[i].getWaitSize(), memory_order_relaxed);
+        peakWait[i].store(courseList[i].getWaitSize(), memory_order_relaxed);
+    }
+    gaugeCourses = courseList;
+    gaugeCount.store(courseCount, memory_order_release);
+}
+
+// Precondition: The caller holds the lock of course `courseId` (updates to one course are not concurrent).
+// Postcondition: The course's waitlist gauge reads `length` and its peak is at least `length`.
+// Ignored until trackCourses() has been called.
+void Metrics::waitlist(int courseId, int length) {
+    if (courseId < 0 || courseId >= gaugeCount.load(memory_order_acquire)) return;
+    currentWait[courseId].store(length, memory_order_relaxed);
+    if (length > peakWait[courseId].load(memory_order_relaxed))
+        peakWait[courseId].store(length, memory_order_relaxed);
+}
+
+// Precondition: `out` is a stream open for writing. Safe to call while other threads record.
+// Postcondition: Prints the merged counters, call counts, latency percentiles in nanoseconds (from the
+// sampled calls) and the longest waitlists.
+void Metrics::dump(FILE* out) {
+    ThreadMetrics* total = new ThreadMetrics();
+    {
+        lock_guard<mutex> guard(registryLock);
+        mergeInto(*total, retiredThreads);
+        for (const ThreadMetrics* metrics : liveThreads)
+            mergeInto(*total, *metrics);
+    }
+
+    // Calibrate ticks against the steady clock over the life of the process (at least 10 ms)
+    if (chrono::steady_clock::now() - startTime < chrono::milliseconds(10))
+        this_thread::sleep_for(chrono::milliseconds(10));
+    double elapsedNs = chrono::duration<double, nano>(chrono::steady_clock::now() - startTime).count();
+    double nsPerTick = elapsedNs / static_cast<double>(now() - startTicks);
+
+    const char* opNames[OPS] = {"registerStudent", "cancelStudent", "findStudent", "readFile1", "readFile2"};
+    fprintf(out, "================ METRICS ================\n");
+    fprintf(out, "%-16s %10s %10s %10s %10s %10s %10s %12s  (latency sampled 1 in %d calls)\n", "operation",
+            "calls", "mean ns", "p50 ns", "p90 ns", "p99 ns", "p99.9 ns", "max ns", SAMPLE_EVERY);
+    for (int op = 0; op < OPS; op++) {
+        uint64_t calls = total->calls[op].load(memory_order_relaxed);
+        uint64_t samples = total->samples[op].load(memory_order_relaxed);
+        if (samples == 0) {
+            fprintf(out, "%-16s %10llu\n", opNames[op], static_cast<unsigned long long>(calls));
+            continue;
+        }
+        double mean = total->totalTicks[op].load(memory_order_relaxed) * nsPerTick / samples;
+        double maximum = total->maxTicks[op].load(memory_order_relaxed) * nsPerTick;
+        const double quantiles[] = {0.50, 0.90, 0.99, 0.999};
+        double values[4];
+        int q = 0;
+        uint64_t seen = 0;
+        for (int b = 0; b < LatencyHistogram::BUCKETS && q < 4; b++) {
+            seen += total->buckets[op][b].load(memory_order_relaxed);
+            while (q < 4 && seen >= max<uint64_t>(1, static_cast<uint64_t>(ceil(quantiles[q] * samples))))
+                values[q++] = min(maximum, LatencyHistogram::bucketValue(b) * nsPerTick);
+        }
+        fprintf(out, "%-16s %10llu %10.0f %10.0f %10.0f %10.0f %10.0f %12.0f\n", opNames[op],
+                static_cast<unsigned long long>(calls), mean, values[0], values[1], values[2], values[3], maximum);
+    }
+
+    const char* counterNames[COUNTERS] = {"enrolled", "waitlisted", "dropped", "left waitlist", "not registered",
+                                          "promoted"};
+    fprintf(out, "events:");
+    for (int i = 0; i < COUNTERS; i++)
+        fprintf(out, "%s %s %llu", i == 0 ? "" : ",", counterNames[i],
+                static_cast<unsigned long long>(total->counters[i].load(memory_order_relaxed)));
+    fprintf(out, "\n");
+    delete total;
+
+    // Waitlist gauges: totals and the ten longest queues right now
+    int courseCount = gaugeCount.load(memory_order_acquire);
+    if (courseCount > 0) {
+        vector<pair<int, int>> longest;     // (current length, course id)
+        long long waiting = 0;
+        int waitingCourses = 0;
+        for (int i = 0; i < courseCount; i++) {
+            int length = currentWait[i].load(memory_order_relaxed);
+            waiting += length;
+            if (length > 0) {
+                waitingCourses++;
+                longest.emplace_back(length, i);
+            }
+        }
+        size_t shown = min<size_t>(10, longest.size());
+        partial_sort(longest.begin(), longest.begin() + shown, longest.end(),
+                     [](const pair<int, int>& a, const pair<int, int>& b) {
+                         return a.first != b.first ? a.first > b.first : a.second < b.second;
+                     });
+        fprintf(out, "waitlists: %lld students waiting in %d of %d courses\n", waiting, waitingCourses, courseCount);
+        for (size_t i = 0; i < shown; i++) {
+            int courseId = longest[i].second;
+            string_view code = gaugeCourses[courseId].getCode();
+            fprintf(out, "  %-10.*s %6d (peak %d)\n", static_cast<int>(code.size()), code.data(), longest[i].first,
+                    peakWait[courseId].load(memory_order_relaxed));
+        }
+    }
+    fflush(out);
+}
+
+// Precondition: Call from the main thread before any other thread is started, so they inherit the signal mask.
+// Postcondition: SIGUSR1 is blocked in every thread and a background thread prints dump(stderr) each time
+// the process receives it (kill -USR1 <pid>).
+void Metrics::dumpOnSignal() {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    thread([signals]() {
+        int received;
+        while (sigwait(&signals, &received) == 0)
+            dump(stderr);
+    }).detach();
+}
@@ -0,0 +1,71 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include "course_registration.h"
+using namespace std;
+
+// Operation counters, latency histograms and waitlist-length gauges for the registration paths.
+// Each thread records into its own block of counters (no locks, no shared cache lines); a dump merges
+// every live thread's block with the totals of threads that have already exited. Every timed call is
+// counted, but only one call in SAMPLE_EVERY per thread reads the clock, which keeps the average cost
+// of a timed call to a few nanoseconds.
+// Build with -DNO_METRICS to compile every METRIC_* hook below out of the binary.
+
+// Operations whose latency is recorded
+enum class TimedOp { REGISTER, CANCEL, FIND, READ_COURSES, READ_ENROLLMENT, COUNT };
+
+// Events that are only counted
+enum class Counter { ENROLLED, WAITLISTED, DROPPED, LEFT_WAITLIST, NOT_REGISTERED, PROMOTED, COUNT };
+
+// Log-linear latency histogram in the style of HdrHistogram: each power of two is split into
+// SUB_BUCKETS linear steps, so any recorded value is reported within 1/SUB_BUCKETS of its true value.
+class LatencyHistogram {
+public:
+    static const int SUB_BITS = 4;
+    static const int SUB_BUCKETS = 1 << SUB_BITS;
+    static const int BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+    static int bucketOf(uint64_t value);
+    static uint64_t bucketValue(int bucket);
+};
+
+class Metrics {
+public:
+    static const int SAMPLE_EVERY = 32;
+    static uint64_t now();
+    static uint64_t begin(TimedOp op);
+    static void record(TimedOp op, uint64_t startTicks);
+    static void count(Counter counter);
+    static void trackCourses(const Course* courseList, int courseCount);
+    static void waitlist(int courseId, int length);
+    static void dump(FILE* out);
+    static void dumpOnSignal();
+};
+
+// Counts one `op` call and, if the call is sampled, records the time from construction to destruction.
+class ScopedTimer {
+private:
+    TimedOp op;
+    uint64_t start;     // 0 when this call is not sampled
+public:
+    ScopedTimer(TimedOp timedOp) : op(timedOp), start(Metrics::begin(timedOp)) {}
+    ~ScopedTimer() { if (start != 0) Metrics::record(op, start); }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+#ifdef NO_METRICS
+#define METRICS_ENABLED 0
+#define METRIC_TIME(op) ((void)0)
+#define METRIC_COUNT(counter) ((void)0)
+#define METRIC_WAITLIST(courseId, length) ((void)0)
+#else
+#define METRICS_ENABLED 1
+#define METRIC_TIME(op) ScopedTimer metricTimer(op)
+#define METRIC_COUNT(counter) Metrics::count(counter)
+#define METRIC_WAITLIST(courseId, length) Metrics::waitlist(courseId, length)
+#endif
+
+#endif //METRICS_H
@@ -0,0 +1,183 @@
+#ifndef ORDER_TREE_H
+#define ORDER_TREE_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+using namespace std;
+
+// Ordered set of distinct keys that answers "how many keys go before this one" in O(log n). It is a treap
+// (a binary search tree kept balanced by random heap priorities) whose nodes sit in one vector and record
+// the size of their subtree, so a rank query walks a single root-to-leaf path. Freed nodes are reused.
+//
+// Compare orders the keys as a strict weak ordering, e.g. less<pair<int64_t, uint64_t>>.
+template <typename Key, typename Compare = less<Key>>
+class OrderTree {
+private:
+    struct Node {
+        Key key;
+        uint32_t priority;
+        int left;
+        int right;
+        int size;
+    };
+    vector<Node> nodes;
+    vector<int> freeNodes;
+    int root;
+    uint32_t seed;
+
+    // Precondition: `node` is -1 or a node in use.
+    // Postcondition: Returns the number of keys in the subtree under `node`.
+    int sizeOf(int node) const { return node < 0 ? 0 : nodes[node].size; }
+
+    // Precondition: `node` is a node in use whose children's sizes are up to date.
+    // Postcondition: The node's size counts itself and both subtrees.
+    void update(int node) { nodes[node].size = 1 + sizeOf(nodes[node].left) + sizeOf(nodes[node].right); }
+
+    // Precondition: None.
+    // Postcondition: Returns the next priority of a fixed xorshift sequence, so runs are reproducible.
+    uint32_t nextPriority() {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+
+    // Precondition: None.
+    // Postcondition: Returns a detached node holding `key`, reusing a freed node when there is one.
+    int allocate(const Key& key) {
+        Node node{key, nextPriority(), -1, -1, 1};
+        if (freeNodes.empty()) {
+            nodes.push_back(node);
+            return static_cast<int>(nodes.size()) - 1;
+        }
+        int slot = freeNodes.back();
+        freeNodes.pop_back();
+        nodes[slot] = node;
+        return slot;
+    }
+
+    // Precondition: `tree` is -1 or the root of a subtree.
+    // Postcondition: `low` holds the keys that go before `key` (and `key` itself if `inclusive`), `high` the rest.
+    void split(int tree, const Key& key, bool inclusive, int& low, int& high) {
+        if (tree < 0) {
+            low = high = -1;
+            return;
+        }
+        bool goesLow = inclusive ? !Compare()(key, nodes[tree].key) : Compare()(nodes[tree].key, key);
+        if (goesLow) {
+            split(nodes[tree].right, key, inclusive, nodes[tree].right, high);
+            low = tree;
+        }
+        else {
+            split(nodes[tree].left, key, inclusive, low, nodes[tree].left);
+            high = tree;
+        }
+        update(tree);
+    }
+
+    // Precondition: Every key under `low` goes before every key under `high`.
+    // Postcondition: Returns the root of one subtree holding both.
+    int merge(int low, int high) {
+        if (low < 0) return high;
+        if (high < 0) return low;
+        if (nodes[low].priority > nodes[high].priority) {
+            nodes[low].right = merge(nodes[low].right, high);
+            update(low);
+            return low;
+        }
+        nodes[high].left = merge(low, nodes[high].left);
+        update(high);
+        return high;
+    }
+public:
+    // Constructor
+    // Precondition: None.
+    // Postcondition: Creates an empty tree.
+    OrderTree() : root(-1), seed(2463534242u) {}
+
+    // Member function
+    // Precondition: `key` is not in the tree.
+    // Postcondition: `key` is in the tree.
+    void insert(const Key& key) {
+        int node = allocate(key);
+        int low, high;
+        split(root, key, false, low, high);
+        root = merge(merge(low, node), high);
+    }
+
+    // Precondition: None.
+    // Postcondition: Removes `key` and returns true, or returns false if it is not in the tree.
+    bool erase(const Key& key) {
+        int low, rest, match, high;
+        split(root, key, false, low, rest);
+        split(rest, key, true, match, high);
+        bool found = match >= 0;
+        if (found) {
+            freeNodes.push_back(match);
+            match = merge(nodes[match].left, nodes[match].right);
+        }
+        root = merge(merge(low, match), high);
+        return found;
+    }
+
+    // Precondition: None.
+    // Postcondition: Returns the number of keys in the tree that go before `key`.
+    int countLess(const Key& key) const {
+        int count = 0;
+        for (int node = root; node >= 0;) {
+            if (Compare()(nodes[node].key, key)) {
+                count += sizeOf(nodes[node].left) + 1;
+                node = nodes[node].right;
+            }
+            else {
+                node = nodes[node].left;
+            }
+        }
+        return count;
+    }
+
+    // Precondition: `sorted` holds distinct keys in Compare order.
+    // Postcondition: The tree holds exactly the keys of `sorted`, built in O(n) along the right spine.
+    void assign(const vector<Key>& sorted) {
+        clear();
+        nodes.reserve(sorted.size());
+        vector<int> spine;
+        for (const Key& key : sorted) {
+            int node = allocate(key);
+            int last = -1;
+            while (!spine.empty() && nodes[spine.back()].priority < nodes[node].priority) {
+                last = spine.back();
+                spine.pop_back();
+                update(last);
+            }
+            nodes[node].left = last;
+            if (!spine.empty())
+                nodes[spine.back()].right = node;
+            spine.push_back(node);
+        }
+        for (size_t i = spine.size(); i-- > 0;)
+            update(spine[i]);
+        root = spine.empty() ? -1 : spine.front();
+    }
+
+    // Precondition: None.
+    // Postcondition: The tree is empty.
+    void clear() {
+        nodes.clear();
+        freeNodes.clear();
+        root = -1;
+    }
+
+    // Getter
+    // Precondition: None.
+    // Postcondition: Returns the number of keys in the tree.
+    int size() const { return sizeOf(root); }
+
+    // Member function
+    // Precondition: None.
+    // Postcondition: The tree has room for `count` keys without reallocating.
+    void reserve(int count) { nodes.reserve(count); }
+};
+
+#endif //ORDER_TREE_H
@@ -0,0 +1,565 @@
+// Durable course data: binary snapshot plus a group-committed write-ahead log.
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include "course_index.h"
+#include "mapped_file.h"
+#include "persistence.h"
+#include "student_registry.h"
+
+using namespace std;
+
+// Snapshot layout: header | students | courses | roster entries | waitlist tickets | string bytes.
+// Each course's entries are its enrolled students in id order followed by its waitlist in promotion order,
+// stored as indexes into the student table. Every waitlist entry also has its arrival ticket, in the same
+// order, so the waitlist is rebuilt exactly under the policy named in the header, which is also the policy
+// the log after the snapshot was written under. Integers use the host byte order, checked by `byteOrder`.
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t lastLsn;
+    uint32_t courseCount;
+    uint32_t studentCount;
+    uint64_t entryCount;
+    uint64_t ticketCount;
+    uint64_t stringBytes;
+    char policy[16];        // PromotionPolicy name, zero-padded
+    uint32_t checksum;      // CRC-32 of everything after the header
+    uint32_t reserved;
+};
+
+struct SnapshotStudent {
+    int32_t id;
+    uint32_t nameOffset;
+    uint32_t nameLength;
+};
+
+struct SnapshotCourse {
+    uint32_t codeOffset;
+    uint32_t codeLength;
+    uint32_t titleOffset;
+    uint32_t titleLength;
+    int32_t enrollSize;
+    int32_t waitSize;
+    uint32_t enrolledCount;
+    uint32_t waitCount;
+};
+
+static const char SNAPSHOT_MAGIC[8] = {'C', 'R', 'S', 'N', 'A', 'P', '0', '1'};
+static const uint32_t SNAPSHOT_VERSION = 2;
+static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+// Precondition: None.
+// Postcondition: Returns the CRC-32 (IEEE) of [`data`, `data` + `length`), continuing from `crc`.
+// Eight bytes are folded per step with eight lookup tables (slicing-by-8), table[k][b] being the CRC of
+// byte b followed by k zero bytes; the result is the same as one table lookup per byte.
+static uint32_t crc32(const char* data, size_t length, uint32_t crc = 0) {
+    static const array<array<uint32_t, 256>, 8> table = [] {
+        array<array<uint32_t, 256>, 8> values;
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; bit++)
+                value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            values[0][i] = value;
+        }
+        for (uint32_t i = 0; i < 256; i++)
+            for (int k = 1; k < 8; k++)
+                values[k][i] = values[0][values[k - 1][i] & 0xFF] ^ (values[k - 1][i] >> 8);
+        return values;
+    }();
+    crc = ~crc;
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    for (; length >= 8; bytes += 8, length -= 8) {
+        uint32_t low = crc ^ (bytes[0] | bytes[1] << 8 | bytes[2] << 16 | uint32_t(bytes[3]) << 24);
+        crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^ table[5][(low >> 16) & 0xFF]
+              ^ table[4][low >> 24] ^ table[3][bytes[4]] ^ table[2][bytes[5]] ^ table[1][bytes[6]]
+              ^ table[0][bytes[7]];
+    }
+    for (; length > 0; bytes++, length--)
+        crc = table[0][(crc ^ *bytes) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// Precondition: `fd` is open for writing.
+// Postcondition: Returns true if all `length` bytes were written.
+static bool writeAll(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0) return false;
+        data += written;
+        length -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+// Precondition: None.
+// Postcondition: Appends the raw bytes of `value` to `buffer`.
+template <typename T>
+static void appendRaw(string& buffer, const T& value) {
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// Precondition: `courseList` points to `courseCount` courses that all use the same promotion policy.
+// Postcondition: Returns that policy, or FIFO if there are no courses.
+static const PromotionPolicy& policyOf(const Course* courseList, int courseCount) {
+    return courseCount > 0 ? courseList[0].getWaitList().getPolicy() : PromotionPolicy::FIFO;
+}
+
+bool writeSnapshot(const string& filename, const Course* courseList, int courseCount, uint64_t lastLsn) {
+    // Precondition: `courseList` points to `courseCount` courses and no transaction is running on them.
+
+    // Postcondition: The courses, rosters, waitlists with their arrival tickets and the promotion policy are
+    // written to `filename` through a temporary
+    // file that is synced and then renamed over it, so a crash leaves either the old or the new snapshot.
+    // Returns false if the file could not be written.
+
+    string students, courses, entries, tickets, strings;
+    unordered_map<const Student*, uint32_t> studentIndex;
+    uint32_t studentCount = 0;
+    uint64_t entryCount = 0;
+    uint64_t ticketCount = 0;
+    auto addString = [&strings](string_view text, uint32_t& offset, uint32_t& length) {
+        offset = static_cast<uint32_t>(strings.size());
+        length = static_cast<uint32_t>(text.size());
+        strings += text;
+    };
+    auto addEntry = [&](const Student* student) {
+        auto inserted = studentIndex.emplace(student, studentCount);
+        if (inserted.second) {
+            SnapshotStudent record;
+            record.id = student->getId();
+            addString(student->getName(), record.nameOffset, record.nameLength);
+            appendRaw(students, record);
+            studentCount++;
+        }
+        appendRaw(entries, inserted.first->second);
+        entryCount++;
+    };
+    for (int i = 0; i < courseCount; i++) {
+        const Course& course = courseList[i];
+        vector<WaitList::Entry> waiting(course.getWaitList().getEntries());
+        sort(waiting.begin(), waiting.end(), WaitList::before);
+        SnapshotCourse record;
+        addString(course.getCode(), record.codeOffset, record.codeLength);
+        addString(course.getTitle(), record.titleOffset, record.titleLength);
+        record.enrollSize = course.getEnrollSize();
+        record.waitSize = course.getWaitSize();
+        record.enrolledCount = static_cast<uint32_t>(course.getRoster().getItems().size());
+        record.waitCount = static_cast<uint32_t>(waiting.size());
+        appendRaw(courses, record);
+        for (const Student* student : course.getRoster().getItems())
+            addEntry(student);
+        for (const WaitList::Entry& entry : waiting) {
+            addEntry(entry.student);
+            appendRaw(tickets, entry.ticket);
+            ticketCount++;
+        }
+    }
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.lastLsn = lastLsn;
+    header.courseCount = static_cast<uint32_t>(courseCount);
+    header.studentCount = studentCount;
+    header.entryCount = entryCount;
+    header.ticketCount = ticketCount;
+    header.stringBytes = strings.size();
+    strncpy(header.policy, policyOf(courseList, courseCount).name, sizeof(header.policy) - 1);
+    uint32_t crc = crc32(students.data(), students.size());
+    crc = crc32(courses.data(), courses.size(), crc);
+    crc = crc32(entries.data(), entries.size(), crc);
+    crc = crc32(tickets.data(), tickets.size(), crc);
+    header.checksum = crc32(strings.data(), strings.size(), crc);
+
+    string temporary = filename + ".tmp";
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    bool ok = writeAll(fd, reinterpret_cast<const char*>(&header), sizeof(header))
+              && writeAll(fd, students.data(), students.size()) && writeAll(fd, courses.data(), courses.size())
+              && writeAll(fd, entries.data(), entries.size()) && writeAll(fd, tickets.data(), tickets.size())
+              && writeAll(fd, strings.data(), strings.size())
+              && fsync(fd) == 0;
+    close(fd);
+    if (!ok || rename(temporary.c_str(), filename.c_str()) != 0) {
+        unlink(temporary.c_str());
+        return false;
+    }
+    // Make the rename itself durable
+    size_t slash = filename.find_last_of('/');
+    string directory = slash == string::npos ? "." : filename.substr(0, max<size_t>(slash, 1));
+    int dirFd = open(directory.c_str(), O_RDONLY);
+    if (dirFd >= 0) {
+        fsync(dirFd);
+        close(dirFd);
+    }
+    return true;
+}
+
+bool readSnapshot(const string& filename, vector<Course>& courses, StudentRegistry& registry, uint64_t& lastLsn) {
+    // Precondition: `courses` is empty.
+
+    // Postcondition: If `filename` holds a valid snapshot, `courses` and `registry` are rebuilt from it
+    // (rosters in id order, waitlists under the saved policy with their saved arrival tickets), `lastLsn` is
+    // the last log record it includes, and true is returned. Otherwise returns false and leaves `courses` empty.
+
+    MappedFile file(filename);
+    if (!file.isOpen() || file.size() < sizeof(SnapshotHeader)) return false;
+    SnapshotHeader header;
+    memcpy(&header, file.begin(), sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 || header.version != SNAPSHOT_VERSION
+        || header.byteOrder != BYTE_ORDER_MARK)
+        return false;
+    uint64_t studentBytes = uint64_t(header.studentCount) * sizeof(SnapshotStudent);
+    uint64_t courseBytes = uint64_t(header.courseCount) * sizeof(SnapshotCourse);
+    uint64_t entryBytes = header.entryCount * sizeof(uint32_t);
+    uint64_t ticketBytes = header.ticketCount * sizeof(uint64_t);
+    if (file.size() != sizeof(header) + studentBytes + courseBytes + entryBytes + ticketBytes + header.stringBytes)
+        return false;
+    header.policy[sizeof(header.policy) - 1] = '\0';
+    const PromotionPolicy* policy = PromotionPolicy::find(header.policy);
+    if (policy == nullptr) return false;
+    const char* studentData = file.begin() + sizeof(header);
+    const char* courseData = studentData + studentBytes;
+    const char* entryData = courseData + courseBytes;
+    const char* ticketData = entryData + entryBytes;
+    const char* stringData = ticketData + ticketBytes;
+    if (crc32(studentData, file.end() - studentData) != header.checksum)
+        return false;
+    auto inStrings = [&header](uint32_t offset, uint32_t length) {
+        return uint64_t(offset) + length <= header.stringBytes;
+    };
+
+    vector<Student*> students(header.studentCount);
+    registry.reserve(header.studentCount);
+    for (uint32_t i = 0; i < header.studentCount; i++) {
+        SnapshotStudent record;
+        memcpy(&record, studentData + i * sizeof(record), sizeof(record));
+        if (!inStrings(record.nameOffset, record.nameLength)) return false;
+        students[i] = registry.add(record.id, string_view(stringData + record.nameOffset, record.nameLength));
+    }
+    // The schedules are built student by student at the end: count each student's courses, then place every
+    // entry in its student's range of one flat array while the courses are restored in id order
+    vector<uint64_t> scheduleStart(uint64_t(header.studentCount) + 1, 0);
+    for (uint64_t k = 0; k < header.entryCount; k++) {
+        uint32_t studentIndex;
+        memcpy(&studentIndex, entryData + k * sizeof(uint32_t), sizeof(uint32_t));
+        if (studentIndex >= header.studentCount) return false;
+        scheduleStart[studentIndex + 1]++;
+    }
+    for (uint32_t i = 0; i < header.studentCount; i++)
+        scheduleStart[i + 1] += scheduleStart[i];
+    vector<uint64_t> scheduleEnd(scheduleStart.begin(), scheduleStart.end() - 1);
+    vector<ScheduleEntry> schedules(header.entryCount);
+    courses.reserve(header.courseCount);
+    uint64_t nextEntry = 0;
+    uint64_t nextTicket = 0;
+    for (uint32_t i = 0; i < header.courseCount; i++) {
+        SnapshotCourse record;
+        memcpy(&record, courseData + i * sizeof(record), sizeof(record));
+        if (!inStrings(record.codeOffset, record.codeLength) || !inStrings(record.titleOffset, record.titleLength)
+            || nextEntry + record.enrolledCount + record.waitCount > header.entryCount
+            || nextTicket + record.waitCount > header.ticketCount) {
+            courses.clear();
+            return false;
+        }
+        courses.emplace_back(static_cast<int>(i), string_view(stringData + record.codeOffset, record.codeLength),
+                             string_view(stringData + record.titleOffset, record.titleLength),
+                             record.enrollSize, record.waitSize);
+        Course& course = courses.back();
+        course.setPromotionPolicy(*policy);
+        vector<Student*> enrolled(record.enrolledCount);
+        for (uint32_t k = 0; k < record.enrolledCount; k++, nextEntry++) {
+            uint32_t studentIndex;
+            memcpy(&studentIndex, entryData + nextEntry * sizeof(uint32_t), sizeof(uint32_t));
+            enrolled[k] = students[studentIndex];
+            schedules[scheduleEnd[studentIndex]++] = ScheduleEntry{static_cast<int>(i), EnrollStatus::ENROLLED};
+        }
+        course.restoreRoster(move(enrolled));
+        // The waitlist was saved in promotion order, which restoreWaitList() takes as a ready-made heap
+        vector<WaitList::Entry> waiting(record.waitCount);
+        for (uint32_t k = 0; k < record.waitCount; k++, nextEntry++, nextTicket++) {
+            uint32_t studentIndex;
+            memcpy(&studentIndex, entryData + nextEntry * sizeof(uint32_t), sizeof(uint32_t));
+            waiting[k].student = students[studentIndex];
+            memcpy(&waiting[k].ticket, ticketData + nextTicket * sizeof(uint64_t), sizeof(uint64_t));
+            schedules[scheduleEnd[studentIndex]++] = ScheduleEntry{static_cast<int>(i), EnrollStatus::WAIT};
+        }
+        course.restoreWaitList(move(waiting));
+    }
+    for (uint32_t i = 0; i < header.studentCount; i++)
+        students[i]->setSchedule(vector<ScheduleEntry>(schedules.begin() + scheduleStart[i],
+                                                       schedules.begin() + scheduleEnd[i]));
+    lastLsn = header.lastLsn;
+    return true;
+}
+
+// Log record: crc32 | payload length | payload, where the payload is
+// lsn (8) | op (1) | student id (4) | name length (2) | code length (2) | name | code.
+static const size_t RECORD_PREFIX = 2 * sizeof(uint32_t);
+static const size_t PAYLOAD_FIXED = sizeof(uint64_t) + 1 + sizeof(int32_t) + 2 * sizeof(uint16_t);
+
+// WriteAheadLog class
+// Constructor
+// Precondition: None.
+// Postcondition: Creates a closed log; call open() before append().
+WriteAheadLog::WriteAheadLog()
+        : fd(-1), nextLsn(1), durableLsn(0), recordCount(0), pendingLastLsn(0), stopping(false), failed(false) {}
+
+// Destructor
+// Precondition: None.
+// Postcondition: Everything appended so far is written and synced, then the writer thread stops.
+WriteAheadLog::~WriteAheadLog() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    workReady.notify_all();
+    if (writer.joinable())
+        writer.join();
+    if (fd >= 0)
+        close(fd);
+}
+
+// Precondition: None.
+// Postcondition: Applies, in log order, every intact record of `filename` whose LSN is greater than `afterLsn`,
+// and stops at the first torn or corrupt record. `lastLsn` is set to the highest LSN seen (at least `afterLsn`).
+// Returns the number of bytes of intact records, which is where appending should continue.
+uint64_t WriteAheadLog::replay(const string& filename, uint64_t afterLsn,
+                               const function<void(const Transaction&)>& apply, uint64_t& lastLsn) {
+    lastLsn = afterLsn;
+    MappedFile file(filename);
+    if (!file.isOpen()) return 0;
+    const char* cursor = file.begin();
+    Transaction transaction;
+    while (static_cast<size_t>(file.end() - cursor) >= RECORD_PREFIX) {
+        uint32_t crc, length;
+        memcpy(&crc, cursor, sizeof(crc));
+        memcpy(&length, cursor + sizeof(crc), sizeof(length));
+        const char* payload = cursor + RECORD_PREFIX;
+        if (length < PAYLOAD_FIXED || static_cast<size_t>(file.end() - payload) < length
+            || crc32(payload, length) != crc)
+            break;
+        uint64_t lsn;
+        uint8_t op;
+        int32_t id;
+        uint16_t nameLength, codeLength;
+        const char* field = payload;
+        memcpy(&lsn, field, sizeof(lsn));
+        field += sizeof(lsn);
+        memcpy(&op, field, sizeof(op));
+        field += sizeof(op);
+        memcpy(&id, field, sizeof(id));
+        field += sizeof(id);
+        memcpy(&nameLength, field, sizeof(nameLength));
+        field += sizeof(nameLength);
+        memcpy(&codeLength, field, sizeof(codeLength));
+        field += sizeof(codeLength);
+        if (PAYLOAD_FIXED + nameLength + codeLength != length || op > static_cast<uint8_t>(Operation::CANCEL))
+            break;
+        if (lsn > lastLsn) {
+            transaction.op = static_cast<Operation>(op);
+            transaction.studentId = id;
+            transaction.name.assign(field, nameLength);
+            transaction.code.assign(field + nameLength, codeLength);
+            apply(transaction);
+            lastLsn = lsn;
+        }
+        cursor = payload + length;
+    }
+    return static_cast<uint64_t>(cursor - file.begin());
+}
+
+// Member function
+// Precondition: The log is not open yet. `validBytes` came from replay() of the same file.
+// Postcondition: Opens `filename` for appending after dropping any torn tail beyond `validBytes`;
+// the next record gets LSN `lastLsn` + 1. Returns false if the file cannot be opened.
+bool WriteAheadLog::open(const string& filename, uint64_t lastLsn, uint64_t validBytes) {
+    fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0 || ftruncate(fd, static_cast<off_t>(validBytes)) != 0) return false;
+    nextLsn = lastLsn + 1;
+    durableLsn = lastLsn;
+    writer = thread(&WriteAheadLog::writerLoop, this);
+    return true;
+}
+
+// Precondition: The log is open and `transaction` is a REGISTER or CANCEL.
+// Postcondition: The record is queued for the writer thread and its LSN is returned. It is durable once
+// waitDurable() for that LSN returns.
+uint64_t WriteAheadLog::append(const Transaction& transaction) {
+    uint16_t nameLength = static_cast<uint16_t>(min<size_t>(transaction.name.size(), UINT16_MAX));
+    uint16_t codeLength = static_cast<uint16_t>(min<size_t>(transaction.code.size(), UINT16_MAX));
+    uint32_t length = static_cast<uint32_t>(PAYLOAD_FIXED + nameLength + codeLength);
+    uint8_t op = static_cast<uint8_t>(transaction.op);
+    int32_t id = transaction.studentId;
+    lock_guard<mutex> guard(lock);
+    uint64_t lsn = nextLsn++;
+    size_t start = pending.size();
+    appendRaw(pending, uint32_t(0));
+    appendRaw(pending, length);
+    appendRaw(pending, lsn);
+    appendRaw(pending, op);
+    appendRaw(pending, id);
+    appendRaw(pending, nameLength);
+    appendRaw(pending, codeLength);
+    pending.append(transaction.name, 0, nameLength);
+    pending.append(transaction.code, 0, codeLength);
+    uint32_t crc = crc32(pending.data() + start + RECORD_PREFIX, length);
+    memcpy(&pending[start], &crc, sizeof(crc));
+    pendingLastLsn = lsn;
+    recordCount++;
+    workReady.notify_one();
+    return lsn;
+}
+
+// Precondition: None.
+// Postcondition: Runs on the writer thread: repeatedly takes everything queued, writes it with one write()
+// and one fdatasync(), and wakes the callers waiting for those records.
+void WriteAheadLog::writerLoop() {
+    unique_lock<mutex> guard(lock);
+    while (true) {
+        workReady.wait(guard, [this] { return stopping || !pending.empty(); });
+        if (pending.empty()) return;
+        string batch;
+        batch.swap(pending);
+        uint64_t upTo = pendingLastLsn;
+        guard.unlock();
+        bool ok = writeAll(fd, batch.data(), batch.size()) && fdatasync(fd) == 0;
+        guard.lock();
+        if (!ok) failed = true;
+        durableLsn = upTo;
+        flushed.notify_all();
+    }
+}
+
+// Precondition: None.
+// Postcondition: Blocks until every record up to `lsn` is on disk. Returns false if a write has failed.
+bool WriteAheadLog::waitDurable(uint64_t lsn) {
+    unique_lock<mutex> guard(lock);
+    flushed.wait(guard, [this, lsn] { return durableLsn >= lsn || failed; });
+    return !failed;
+}
+
+// Getter
+// Precondition: None.
+// Postcondition: Returns the LSN of the last appended record.
+uint64_t WriteAheadLog::getLastLsn() {
+    lock_guard<mutex> guard(lock);
+    return nextLsn - 1;
+}
+
+// Precondition: None.
+// Postcondition: Returns the number of records appended since the log was opened or last truncated.
+uint64_t WriteAheadLog::getRecordCount() {
+    lock_guard<mutex> guard(lock);
+    return recordCount;
+}
+
+// Member function
+// Precondition: Every appended record is durable and already included in a snapshot.
+// Postcondition: The log file is emptied; LSNs keep increasing from where they were.
+bool WriteAheadLog::truncate() {
+    lock_guard<mutex> guard(lock);
+    recordCount = 0;
+    return ftruncate(fd, 0) == 0 && fdatasync(fd) == 0;
+}
+
+// DurableState class
+// Constructor
+// Precondition: None.
+// Postcondition: Uses `stateDirectory` (created if missing) for snapshot.bin and wal.log.
+DurableState::DurableState(const string& stateDirectory)
+        : directory(stateDirectory), courseList(nullptr), courseCount(0), snapshotLsn(0), snapshotPolicy(nullptr),
+          snapshotLoaded(false) {
+    mkdir(directory.c_str(), 0755);
+}
+
+// Precondition: None.
+// Postcondition: Returns the path of the snapshot file.
+string DurableState::snapshotPath() const { return directory + "/snapshot.bin"; }
+
+// Precondition: None.
+// Postcondition: Returns the path of the log file.
+string DurableState::walPath() const { return directory + "/wal.log"; }
+
+// Precondition: None.
+// Postcondition: Returns true if the state directory holds a snapshot.
+bool DurableState::hasSnapshot() const {
+    return access(snapshotPath().c_str(), F_OK) == 0;
+}
+
+// Precondition: `courses` is empty and `registry` has no students.
+// Postcondition: Rebuilds the courses and students from the snapshot and returns true, or returns false
+// if the snapshot is missing or damaged. The waitlists use the policy the snapshot was saved under.
+bool DurableState::loadSnapshot(vector<Course>& courses, StudentRegistry& registry) {
+    snapshotLoaded = readSnapshot(snapshotPath(), courses, registry, snapshotLsn);
+    if (snapshotLoaded)
+        snapshotPolicy = &policyOf(courses.data(), static_cast<int>(courses.size()));
+    return snapshotLoaded;
+}
+
+// Member function
+// Precondition: `courseList` holds the courses loaded from the snapshot, still under the snapshot's policy (or
+// from the text files when there is no snapshot yet), `index` was built from it and `registry` owns its students.
+// Postcondition: Every logged transaction newer than the snapshot is replayed, the log is reopened for appending,
+// and if there was no snapshot one is written now. Returns false if the log or snapshot cannot be written.
+bool DurableState::open(Course* courseList, int courseCount, const CourseIndex& index, StudentRegistry& registry) {
+    this->courseList = courseList;
+    this->courseCount = courseCount;
+    uint64_t lastLsn = 0;
+    uint64_t replayed = 0;
+    uint64_t validBytes = WriteAheadLog::replay(walPath(), snapshotLsn, [&](const Transaction& transaction) {
+        executeTransaction(transaction, index.find(transaction.code), courseList, registry);
+        replayed++;
+    }, lastLsn);
+    if (replayed > 0)
+        cerr << "Replayed " << replayed << " logged transactions." << endl;
+    if (!wal.open(walPath(), lastLsn, validBytes)) return false;
+    if (!snapshotLoaded || replayed >= CHECKPOINT_RECORDS)
+        return checkpoint();
+    return true;
+}
+
+// Precondition: open() succeeded. Called with the course lock of `transaction.code` held, so records of
+// the same course are logged in the order they were applied.
+// Postcondition: The transaction is queued in the log.
+void DurableState::log(const Transaction& transaction) {
+    wal.append(transaction);
+}
+
+// Precondition: open() succeeded and no transaction is running.
+// Postcondition: Waits until every logged transaction is on disk, then writes a new snapshot if the log has
+// grown past CHECKPOINT_RECORDS. Returns false if anything could not be written.
+bool DurableState::commit() {
+    if (!wal.waitDurable(wal.getLastLsn())) return false;
+    if (wal.getRecordCount() >= CHECKPOINT_RECORDS)
+        return checkpoint();
+    return true;
+}
+
+// Precondition: open() succeeded and no transaction is running.
+// Postcondition: The current courses are written to a new snapshot and the log is emptied.
+// Nothing is written if the snapshot is already current, including its promotion policy, so a policy
+// change is saved before anything is logged under it. Returns false if the snapshot or the log
+// could not be written.
+bool DurableState::checkpoint() {
+    uint64_t lastLsn = wal.getLastLsn();
+    const PromotionPolicy* policy = &policyOf(courseList, courseCount);
+    if (snapshotLoaded && lastLsn == snapshotLsn && policy == snapshotPolicy) return true;
+    if (!wal.waitDurable(lastLsn)) return false;
+    if (!writeSnapshot(snapshotPath(), courseList, courseCount, lastLsn)) return false;
+    snapshotLsn = lastLsn;
+    snapshotPolicy = policy;
+    snapshotLoaded = true;
+    return wal.truncate();
+}
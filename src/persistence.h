@@ -0,0 +1,77 @@
+#ifndef PERSISTENCE_H
+#define PERSISTENCE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "batch.h"
+#include "course_registration.h"
+using namespace std;
+
+bool writeSnapshot(const string& filename, const Course* courseList, int courseCount, uint64_t lastLsn);
+bool readSnapshot(const string& filename, vector<Course>& courses, StudentRegistry& registry, uint64_t& lastLsn);
+
+// Append-only log of REGISTER and CANCEL transactions with group commit.
+// append() only queues a record; a background thread writes everything queued so far with one write()
+// and one fdatasync(), so concurrent callers share the cost of each flush.
+// Every record carries a log sequence number (LSN) and a CRC, so a torn tail is detected and dropped.
+class WriteAheadLog {
+private:
+    int fd;
+    uint64_t nextLsn;
+    uint64_t durableLsn;
+    uint64_t recordCount;
+    string pending;
+    uint64_t pendingLastLsn;
+    mutex lock;
+    condition_variable workReady;
+    condition_variable flushed;
+    bool stopping;
+    bool failed;
+    thread writer;
+    void writerLoop();
+public:
+    WriteAheadLog();
+    ~WriteAheadLog();
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+    static uint64_t replay(const string& filename, uint64_t afterLsn, const function<void(const Transaction&)>& apply,
+                           uint64_t& lastLsn);
+    bool open(const string& filename, uint64_t lastLsn, uint64_t validBytes);
+    uint64_t append(const Transaction& transaction);
+    bool waitDurable(uint64_t lsn);
+    uint64_t getLastLsn();
+    uint64_t getRecordCount();
+    bool truncate();
+};
+
+// Keeps the course data of one state directory durable: a binary snapshot (snapshot.bin) plus the
+// write-ahead log of everything since (wal.log). A restart maps the snapshot and replays the log under the
+// promotion policy saved in the snapshot.
+class DurableState {
+private:
+    string directory;
+    const Course* courseList;
+    int courseCount;
+    uint64_t snapshotLsn;
+    const PromotionPolicy* snapshotPolicy;
+    bool snapshotLoaded;
+    WriteAheadLog wal;
+    string snapshotPath() const;
+    string walPath() const;
+public:
+    static const uint64_t CHECKPOINT_RECORDS = 100000;
+    DurableState(const string& stateDirectory);
+    bool hasSnapshot() const;
+    bool loadSnapshot(vector<Course>& courses, StudentRegistry& registry);
+    bool open(Course* courseList, int courseCount, const CourseIndex& index, StudentRegistry& registry);
+    void log(const Transaction& transaction);
+    bool commit();
+    bool checkpoint();
+};
+
+#endif //PERSISTENCE_H
@@ -0,0 +1,385 @@
+// Enrollment report: formats every course section into memory on several threads and writes the
+// sections to the output in catalog order, optionally keeping them for the next report.
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <climits>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "report.h"
+
+using namespace std;
+
+// Courses formatted per unit of work; large enough that one section buffer makes a sizeable write
+static const int CHUNK_COURSES = 64;
+
+// Precondition: None.
+// Postcondition: Appends the decimal form of `value` to `out`.
+static void appendInt(string& out, int value) {
+    char digits[16];
+    to_chars_result result = to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, result.ptr - digits);
+}
+
+// Precondition: None.
+// Postcondition: Appends `text` left-aligned in a column of `width` characters, like `left << setw(width)`.
+static void appendPadded(string& out, string_view text, size_t width) {
+    out += text;
+    if (text.size() < width)
+        out.append(width - text.size(), ' ');
+}
+
+// Precondition: None.
+// Postcondition: Appends `text` as one CSV field, quoted when it contains a separator, quote or line break.
+static void appendCsvField(string& out, string_view text) {
+    if (text.find_first_of(",\"\r\n") == string_view::npos) {
+        out += text;
+        return;
+    }
+    out += '"';
+    for (char c : text) {
+        if (c == '"')
+            out += '"';
+        out += c;
+    }
+    out += '"';
+}
+
+// Precondition: `format` is CSV or TSV.
+// Postcondition: Appends one row describing `student`'s place in `course`, whose capacities are
+// `enrollSize` and `waitSize`. TSV fields are written as they are: codes, titles and names never contain
+// tabs or line breaks, because the data files split their fields on whitespace.
+static void appendRow(string& out, const Course& course, int enrollSize, int waitSize, ReportFormat format,
+                      const char* status, int position, const Student* student) {
+    char separator = format == ReportFormat::CSV ? ',' : '\t';
+    if (format == ReportFormat::CSV) {
+        appendCsvField(out, course.getCode());
+        out += separator;
+        appendCsvField(out, course.getTitle());
+    } else {
+        out += course.getCode();
+        out += separator;
+        out += course.getTitle();
+    }
+    out += separator;
+    appendInt(out, enrollSize);
+    out += separator;
+    appendInt(out, waitSize);
+    out += separator;
+    out += status;
+    out += separator;
+    if (position > 0)
+        appendInt(out, position);
+    out += separator;
+    appendInt(out, student->getId());
+    out += separator;
+    if (format == ReportFormat::CSV)
+        appendCsvField(out, student->getName());
+    else
+        out += student->getName();
+    out += '\n';
+}
+
+// Precondition: None.
+// Postcondition: Returns true and sets `format` if `name` is "text", "csv" or "tsv"; otherwise returns false.
+bool parseReportFormat(const string& name, ReportFormat& format) {
+    if (name == "text")
+        format = ReportFormat::TEXT;
+    else if (name == "csv")
+        format = ReportFormat::CSV;
+    else if (name == "tsv")
+        format = ReportFormat::TSV;
+    else
+        return false;
+    return true;
+}
+
+// Precondition: None.
+// Postcondition: Appends the column header line for CSV and TSV; TEXT has no header.
+void appendReportHeader(ReportFormat format, string& out) {
+    if (format == ReportFormat::TEXT) return;
+    char separator = format == ReportFormat::CSV ? ',' : '\t';
+    const char* columns[] = {"code", "title", "enrolled_count", "waitlist_count", "status", "position",
+                             "student_id", "student_name"};
+    for (size_t i = 0; i < sizeof(columns) / sizeof(columns[0]); i++) {
+        if (i > 0)
+            out += separator;
+        out += columns[i];
+    }
+    out += '\n';
+}
+
+// Precondition: `enrolled` and `waiting` are the course's students in id order and in promotion order.
+// Postcondition: Appends the course's section to `out` in the given format, for a live course or a snapshot.
+// The TEXT section is byte-for-byte what Course::getAllInfo used to print with iostream formatting.
+template <typename StudentPointer>
+static void appendSection(const Course& course, int enrollSize, int waitSize, const vector<StudentPointer>& enrolled,
+                          const vector<StudentPointer>& waiting, ReportFormat format, string& out) {
+    if (format != ReportFormat::TEXT) {
+        for (const Student* student : enrolled)
+            appendRow(out, course, enrollSize, waitSize, format, "enrolled", 0, student);
+        for (size_t i = 0; i < waiting.size(); i++)
+            appendRow(out, course, enrollSize, waitSize, format, "waitlisted", static_cast<int>(i) + 1, waiting[i]);
+        return;
+    }
+    out += "[ ";
+    appendPadded(out, course.getCode(), 10);
+    appendPadded(out, course.getTitle(), 15);
+    out += " (";
+    appendInt(out, enrollSize);
+    out += ")  ]\n";
+    out += "---------------------------------------\n";
+    string id;
+    for (const Student* student : enrolled) {
+        id.clear();
+        appendInt(id, student->getId());
+        appendPadded(out, id, 15);
+        appendPadded(out, student->getName(), 15);
+        out += '\n';
+    }
+    out += '\n';
+    if (waitSize > 0) {
+        out += "  <  Waitlist  (";
+        appendInt(out, waitSize);
+        out += ")  >\n";
+        for (const Student* student : waiting) {
+            id.clear();
+            appendInt(id, student->getId());
+            appendPadded(out, id, 15);
+            appendPadded(out, student->getName(), 15);
+            out += '\n';
+        }
+        out += '\n';
+    }
+}
+
+// Precondition: No transaction is changing `course`.
+// Postcondition: Appends the course's enrolled students and waitlist to `out` in the given format.
+void appendCourseSection(const Course& course, ReportFormat format, string& out) {
+    appendSection(course, course.getEnrollSize(), course.getWaitSize(), course.getRoster().getItems(),
+                  course.getWaitList().getStudents(), format, out);
+}
+
+// Precondition: None; the view never changes.
+// Postcondition: Appends the course's section as of the view's snapshot to `out` in the given format.
+void appendCourseSection(const CourseView& view, ReportFormat format, string& out) {
+    vector<WaitList::Entry> entries(view.waiting);
+    sort(entries.begin(), entries.end(), WaitList::before);
+    vector<const Student*> waiting;
+    waiting.reserve(entries.size());
+    for (const WaitList::Entry& entry : entries)
+        waiting.push_back(entry.student);
+    appendSection(*view.course, view.enrollSize, view.waitSize, view.enrolled, waiting, format, out);
+}
+
+// Precondition: `courseList` points to `courseCount` valid Course objects and no transaction is running.
+// `out` is a stream open for writing.
+// Postcondition: Writes the report for every course to `out` in catalog order and returns true if every
+// write succeeded. `threadCount` threads format chunks of courses into their own buffers while the
+// calling thread writes finished chunks in order, one write per chunk, and frees them.
+bool writeReport(const Course* courseList, int courseCount, ReportFormat format, FILE* out, int threadCount) {
+    int chunkCount = (courseCount + CHUNK_COURSES - 1) / CHUNK_COURSES;
+    vector<string> chunks(chunkCount);
+    vector<char> ready(chunkCount, 0);
+    int nextChunk = 0;
+    mutex lock;
+    condition_variable chunkReady;
+
+    auto formatChunks = [&]() {
+        while (true) {
+            int chunk;
+            {
+                lock_guard<mutex> guard(lock);
+                if (nextChunk == chunkCount) return;
+                chunk = nextChunk++;
+            }
+            string text;
+            int last = min(courseCount, (chunk + 1) * CHUNK_COURSES);
+            for (int i = chunk * CHUNK_COURSES; i < last; i++)
+                appendCourseSection(courseList[i], format, text);
+            {
+                lock_guard<mutex> guard(lock);
+                chunks[chunk].swap(text);
+                ready[chunk] = 1;
+            }
+            chunkReady.notify_one();
+        }
+    };
+    vector<thread> workers;
+    for (int i = 0; i < max(1, min(threadCount, chunkCount)); i++)
+        workers.emplace_back(formatChunks);
+
+    string header;
+    appendReportHeader(format, header);
+    bool ok = fwrite(header.data(), 1, header.size(), out) == header.size();
+    for (int chunk = 0; chunk < chunkCount; chunk++) {
+        string text;
+        {
+            unique_lock<mutex> guard(lock);
+            chunkReady.wait(guard, [&] { return ready[chunk] != 0; });
+            text.swap(chunks[chunk]);
+        }
+        if (ok)
+            ok = fwrite(text.data(), 1, text.size(), out) == text.size();
+    }
+    for (thread& worker : workers)
+        worker.join();
+    return fflush(out) == 0 && ok;
+}
+
+// Precondition: `pieces` point to readable bytes.
+// Postcondition: Writes every piece to `fd` in order, resuming after partial writes, and returns true on success.
+static bool writePieces(int fd, vector<iovec>& pieces) {
+    size_t first = 0;
+    while (first < pieces.size()) {
+        ssize_t written = writev(fd, pieces.data() + first, static_cast<int>(min<size_t>(pieces.size() - first, IOV_MAX)));
+        if (written < 0 && errno == EINTR) continue;
+        if (written < 0) return false;
+        size_t remaining = static_cast<size_t>(written);
+        while (first < pieces.size() && remaining >= pieces[first].iov_len)
+            remaining -= pieces[first++].iov_len;
+        if (remaining > 0) {
+            pieces[first].iov_base = static_cast<char*>(pieces[first].iov_base) + remaining;
+            pieces[first].iov_len -= remaining;
+        }
+    }
+    pieces.clear();
+    return true;
+}
+
+// ReportCache class
+// Constructor
+// Precondition: None.
+// Postcondition: Creates an empty cache for sections in `reportFormat`.
+ReportCache::ReportCache(ReportFormat reportFormat) : format(reportFormat) {}
+
+// Getter
+// Precondition: None.
+// Postcondition: Returns the format the sections are rendered in.
+ReportFormat ReportCache::getFormat() const { return format; }
+
+// Member function
+// Precondition: None.
+// Postcondition: There is an entry for every course id below `courseCount`; new entries are not rendered yet.
+void ReportCache::grow(int courseCount) {
+    if (sections.size() < static_cast<size_t>(courseCount))
+        sections.resize(courseCount, Section{NEVER, string()});
+}
+
+// Precondition: `stale` lists course ids below sections.size(); `render` may run on several threads at once
+// for different courses.
+// Postcondition: `render` ran for every id in `stale`, in chunks of courses on up to `threadCount` threads.
+static void renderInParallel(const vector<int>& stale, const function<void(int)>& render, int threadCount) {
+    atomic<size_t> nextCourse(0);
+    auto renderStale = [&]() {
+        size_t position;
+        while ((position = nextCourse.fetch_add(CHUNK_COURSES)) < stale.size()) {
+            size_t last = min(stale.size(), position + CHUNK_COURSES);
+            for (; position < last; position++)
+                render(stale[position]);
+        }
+    };
+    int chunkCount = static_cast<int>((stale.size() + CHUNK_COURSES - 1) / CHUNK_COURSES);
+    vector<thread> workers;
+    for (int i = 1; i < min(threadCount, chunkCount); i++)
+        workers.emplace_back(renderStale);
+    renderStale();
+    for (thread& worker : workers)
+        worker.join();
+}
+
+// Precondition: `courseList` points to `courseCount` valid Course objects and no transaction is running.
+// Postcondition: Every section matches its course's current version. Only the stale sections are rendered,
+// in chunks of courses on up to `threadCount` threads. Returns the number of sections rendered.
+int ReportCache::refresh(const Course* courseList, int courseCount, int threadCount) {
+    grow(courseCount);
+    vector<int> stale;
+    for (int i = 0; i < courseCount; i++) {
+        if (sections[i].version != courseList[i].getVersion())
+            stale.push_back(i);
+    }
+    renderInParallel(stale, [&](int courseId) {
+        Section& entry = sections[courseId];
+        entry.text.clear();
+        appendCourseSection(courseList[courseId], format, entry.text);
+        entry.version = courseList[courseId].getVersion();
+    }, threadCount);
+    return static_cast<int>(stale.size());
+}
+
+// Precondition: None; transactions may run while the snapshot is read.
+// Postcondition: Every section matches its course's view in `snapshot`, rendered as refresh() above.
+// Returns the number of sections rendered.
+int ReportCache::refresh(const SnapshotStore::Reader& snapshot, int threadCount) {
+    grow(snapshot.courseCount());
+    vector<int> stale;
+    for (int i = 0; i < snapshot.courseCount(); i++) {
+        if (sections[i].version != snapshot.view(i).version)
+            stale.push_back(i);
+    }
+    renderInParallel(stale, [&](int courseId) {
+        Section& entry = sections[courseId];
+        entry.text.clear();
+        appendCourseSection(snapshot.view(courseId), format, entry.text);
+        entry.version = snapshot.view(courseId).version;
+    }, threadCount);
+    return static_cast<int>(stale.size());
+}
+
+// Precondition: No transaction is changing `course`.
+// Postcondition: Returns the course's section, rendering it first if the course changed since it was cached.
+const string& ReportCache::section(const Course& course) {
+    grow(course.getId() + 1);
+    Section& entry = sections[course.getId()];
+    if (entry.version != course.getVersion()) {
+        entry.text.clear();
+        appendCourseSection(course, format, entry.text);
+        entry.version = course.getVersion();
+    }
+    return entry.text;
+}
+
+// Precondition: None.
+// Postcondition: Returns the section for the view's course as of its snapshot, rendering it first if the
+// cached text is from another version.
+const string& ReportCache::section(const CourseView& view) {
+    grow(view.course->getId() + 1);
+    Section& entry = sections[view.course->getId()];
+    if (entry.version != view.version) {
+        entry.text.clear();
+        appendCourseSection(view, format, entry.text);
+        entry.version = view.version;
+    }
+    return entry.text;
+}
+
+// Precondition: `courseList` points to `courseCount` valid Course objects and no transaction is running.
+// `out` is a stream open for writing on a file descriptor.
+// Postcondition: Writes the report in the cache's format for every course to `out` in catalog order and
+// returns true if every write succeeded. Courses changed since the cache last saw them are rendered again
+// on up to `threadCount` threads; the sections then go out straight from the cache, up to IOV_MAX per writev.
+bool writeReport(const Course* courseList, int courseCount, ReportCache& cache, FILE* out, int threadCount) {
+    cache.refresh(courseList, courseCount, threadCount);
+    string header;
+    appendReportHeader(cache.getFormat(), header);
+    bool ok = fflush(out) == 0;
+    int fd = fileno(out);
+    vector<iovec> pieces;
+    if (!header.empty())
+        pieces.push_back(iovec{const_cast<char*>(header.data()), header.size()});
+    for (int i = 0; i < courseCount && ok; i++) {
+        const string& text = cache.section(courseList[i]);
+        if (!text.empty())
+            pieces.push_back(iovec{const_cast<char*>(text.data()), text.size()});
+        if (pieces.size() == IOV_MAX)
+            ok = writePieces(fd, pieces);
+    }
+    return ok && writePieces(fd, pieces);
+}
@@ -0,0 +1,51 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "course_registration.h"
+#include "snapshot.h"
+using namespace std;
+
+// Layout of the enrollment report.
+// TEXT is the menu's course-by-course listing; CSV and TSV emit one row per student for other tools:
+//   code, title, enrolled_count, waitlist_count, status (enrolled | waitlisted), position, student_id, student_name
+// where enrolled_count and waitlist_count are the course's current counts (as in the course file, kept up to
+// date by registrations) and position is the 1-based place on the waitlist, empty for enrolled students.
+enum class ReportFormat { TEXT, CSV, TSV };
+
+// Rendered course sections kept from one report to the next.
+// Each section remembers the Course::getVersion() it was rendered at, so a repeated report formats only the
+// courses that changed since and writes the rest straight from memory. The cache holds one copy of the
+// report text. Filled from live courses it may only be used while no transaction is running; filled from a
+// SnapshotStore::Reader it may be used at any time, by one thread at a time. Views carry the same version
+// numbers as their courses, so both ways share sections.
+class ReportCache {
+private:
+    struct Section {
+        uint64_t version;
+        string text;
+    };
+    ReportFormat format;
+    vector<Section> sections;
+    static const uint64_t NEVER = UINT64_MAX;
+    void grow(int courseCount);
+public:
+    ReportCache(ReportFormat reportFormat);
+    ReportFormat getFormat() const;
+    int refresh(const Course* courseList, int courseCount, int threadCount);
+    int refresh(const SnapshotStore::Reader& snapshot, int threadCount);
+    const string& section(const Course& course);
+    const string& section(const CourseView& view);
+};
+
+bool parseReportFormat(const string& name, ReportFormat& format);
+void appendReportHeader(ReportFormat format, string& out);
+void appendCourseSection(const Course& course, ReportFormat format, string& out);
+void appendCourseSection(const CourseView& view, ReportFormat format, string& out);
+bool writeReport(const Course* courseList, int courseCount, ReportFormat format, FILE* out, int threadCount);
+bool writeReport(const Course* courseList, int courseCount, ReportCache& cache, FILE* out, int threadCount);
+
+#endif //REPORT_H
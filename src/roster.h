@@ -0,0 +1,124 @@
+#ifndef ROSTER_H
+#define ROSTER_H
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+using namespace std;
+
+// Sorted list of items kept in two contiguous arrays: `keys` holds each item's key, taken once by `KeyOf`
+// when the item is added, and `items` holds the items in the same order. Searches run a binary search over
+// the dense key array with `Compare` and then compare items with ==, all inline, so a lookup never calls
+// out to the item's type. Equal keys are allowed; add() puts a new item in front of its equals.
+//
+// KeyOf is a function object with a `type` member naming the key type, e.g.
+//   struct StudentIdKey { using type = int; int operator()(const Student* student) const; };
+template <typename T, typename KeyOf, typename Compare = less<typename KeyOf::type>>
+class Roster {
+public:
+    using Key = typename KeyOf::type;
+private:
+    vector<Key> keys;
+    vector<T> items;
+
+    // Precondition: `KeyOf` accepts `item` and `item` compares with T by ==.
+    // Postcondition: Returns the index of `item`, or items.size() if it is not on the roster.
+    template <typename Probe>
+    size_t indexOf(const Probe& item) const {
+        Key key = KeyOf()(item);
+        size_t i = lower_bound(keys.begin(), keys.end(), key, Compare()) - keys.begin();
+        for (; i < keys.size() && !Compare()(key, keys[i]); i++) {
+            if (items[i] == item)
+                return i;
+        }
+        return items.size();
+    }
+public:
+    // Member function
+    // Precondition: None.
+    // Postcondition: The item is inserted in key order, ahead of any items with the same key.
+    void add(const T& item) {
+        Key key = KeyOf()(item);
+        size_t offset = lower_bound(keys.begin(), keys.end(), key, Compare()) - keys.begin();
+        keys.insert(keys.begin() + offset, key);
+        items.insert(items.begin() + offset, item);
+    }
+
+    // Precondition: None.
+    // Postcondition: The roster is the same as after calling add() for each item of `batch` in order, but is
+    // built with one merge pass instead of one shifting insert per item.
+    void addAll(vector<T> batch) {
+        // add() puts an item in front of any equal key, so later batch entries go first among equals and the
+        // whole batch goes in front of items already on the roster with the same key
+        reverse(batch.begin(), batch.end());
+        vector<Key> batchKeys(batch.size());
+        vector<size_t> order(batch.size());
+        for (size_t i = 0; i < batch.size(); i++) {
+            batchKeys[i] = KeyOf()(batch[i]);
+            order[i] = i;
+        }
+        stable_sort(order.begin(), order.end(),
+                    [&batchKeys](size_t a, size_t b) { return Compare()(batchKeys[a], batchKeys[b]); });
+        vector<Key> mergedKeys;
+        vector<T> merged;
+        mergedKeys.reserve(keys.size() + batch.size());
+        merged.reserve(items.size() + batch.size());
+        size_t existing = 0;
+        for (size_t next : order) {
+            for (; existing < keys.size() && Compare()(keys[existing], batchKeys[next]); existing++) {
+                mergedKeys.push_back(keys[existing]);
+                merged.push_back(items[existing]);
+            }
+            mergedKeys.push_back(batchKeys[next]);
+            merged.push_back(batch[next]);
+        }
+        mergedKeys.insert(mergedKeys.end(), keys.begin() + existing, keys.end());
+        merged.insert(merged.end(), items.begin() + existing, items.end());
+        keys.swap(mergedKeys);
+        items.swap(merged);
+    }
+
+    // Precondition: `item` is a T or compares with one by == (a const pointer for a pointer T).
+    // Postcondition: Removes the item and returns true, or returns false if the item is not on the roster.
+    template <typename Probe>
+    bool remove(const Probe& item) {
+        size_t i = indexOf(item);
+        if (i == items.size()) return false;
+        keys.erase(keys.begin() + i);
+        items.erase(items.begin() + i);
+        return true;
+    }
+
+    // Precondition: `item` is a T or compares with one by == (a const pointer for a pointer T).
+    // Postcondition: Returns true if the item is on the roster, otherwise false.
+    template <typename Probe>
+    bool find(const Probe& item) const { return indexOf(item) < items.size(); }
+
+    // Getter
+    // Precondition: None.
+    // Postcondition: Returns the number of items on the roster.
+    int size() const { return static_cast<int>(items.size()); }
+
+    // Member function
+    // Precondition: None.
+    // Postcondition: The roster has room for `count` items without reallocating.
+    void reserve(int count) {
+        keys.reserve(count);
+        items.reserve(count);
+    }
+
+    // Getter
+    // Precondition: None.
+    // Postcondition: Returns the items in key order.
+    const vector<T>& getItems() const { return items; }
+
+    // Member function
+    // Precondition: T is a pointer to a type with print().
+    // Postcondition: Prints every item to the console in key order.
+    void printList() const {
+        for (const T& item : items)
+            item->print();
+    }
+};
+
+#endif //ROSTER_H
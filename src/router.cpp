@@ -0,0 +1,704 @@
+// Shard router: one epoll loop that spreads client requests over the shard worker processes and merges
+// their answers.
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <unordered_set>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/prctl.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "course_index.h"
+#include "mapped_file.h"
+#include "router.h"
+#include "server.h"
+
+using namespace std;
+
+// Precondition: `transaction` was parsed by parseTransaction().
+// Postcondition: Appends the request line a RegistrationServer reads as the same transaction.
+static void appendRequest(const Transaction& transaction, string& out) {
+    static const char* const keywords[] = {"REGISTER ", "CANCEL ", "QUERY ", "OVERLAP "};
+    out += keywords[static_cast<int>(transaction.op)];
+    if (transaction.op == Operation::OVERLAP) {
+        out += transaction.code;
+        out += ' ';
+        out += transaction.otherCode;
+    } else {
+        out += to_string(transaction.studentId);
+        out += ' ';
+        out += transaction.name;
+        if (transaction.op != Operation::QUERY) {
+            out += ' ';
+            out += transaction.code;
+        }
+    }
+    out += '\n';
+}
+
+// ShardRouter class
+// Constructor
+// Precondition: `catalog` is mapped, and RegistrationServer::blockStopSignals() ran before any thread started.
+// Postcondition: The event loop is set up and watches for SIGINT/SIGTERM; no worker runs and nothing listens.
+ShardRouter::ShardRouter(const ShardCatalog& catalog)
+        : catalog(catalog), listenFd(-1), workers(catalog.getShardCount()), stopping(false),
+          workerLost(false) {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    sigset_t signals = stopSignals();
+    signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = signalFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, signalFd, &event);
+}
+
+// Destructor
+// Precondition: None.
+// Postcondition: The workers are stopped, and every socket is closed; the Unix socket file is removed.
+ShardRouter::~ShardRouter() {
+    stopWorkers();
+    for (auto& entry : clients)
+        ::close(entry.first);
+    if (listenFd >= 0)
+        ::close(listenFd);
+    if (!unixPath.empty())
+        unlink(unixPath.c_str());
+    ::close(signalFd);
+    ::close(epollFd);
+}
+
+// Member function
+// Precondition: The catalog lives in the shared memory segment `segmentName`. `stateDirectory` is empty or
+// a directory path. `workerOptions` are passed on to every worker (e.g. --threads 4).
+// Postcondition: Returns true once one --shard-worker process per shard has loaded its courses from the
+// catalog and its students from `enrollmentFile` (or from <stateDirectory>/shard<i>) and accepted the
+// router's connection. Workers are this program started again, and are sent SIGTERM if the router dies.
+// Returns false if a worker exits first or SIGINT/SIGTERM arrives meanwhile.
+bool ShardRouter::startWorkers(const string& segmentName, const string& enrollmentFile, const string& stateDirectory,
+                               const vector<string>& workerOptions) {
+    if (!stateDirectory.empty())
+        mkdir(stateDirectory.c_str(), 0755);
+    pid_t router = getpid();
+    for (size_t shard = 0; shard < workers.size(); shard++) {
+        Worker& worker = workers[shard];
+        worker.socketPath = "/tmp" + segmentName + "-shard" + to_string(shard) + ".sock";
+        vector<string> arguments = {"registration", "--shard-worker", segmentName, to_string(shard), enrollmentFile,
+                                    "--unix", worker.socketPath};
+        if (!stateDirectory.empty()) {
+            arguments.push_back("--state");
+            arguments.push_back(stateDirectory + "/shard" + to_string(shard));
+        }
+        arguments.insert(arguments.end(), workerOptions.begin(), workerOptions.end());
+        vector<char*> argv;
+        for (string& argument : arguments)
+            argv.push_back(&argument[0]);
+        argv.push_back(nullptr);
+        worker.pid = fork();
+        if (worker.pid == 0) {
+            prctl(PR_SET_PDEATHSIG, SIGTERM);
+            if (getppid() != router)
+                _exit(1);
+            execv("/proc/self/exe", argv.data());
+            _exit(127);
+        }
+        if (worker.pid < 0) {
+            cerr << "Cannot start shard worker " << shard << ": " << strerror(errno) << endl;
+            return false;
+        }
+    }
+
+    // Workers listen once their shard is loaded; keep trying until each one answers
+    for (size_t shard = 0; shard < workers.size(); shard++) {
+        while (!connectWorker(workers[shard])) {
+            signalfd_siginfo info;
+            if (read(signalFd, &info, sizeof(info)) == sizeof(info))
+                return false;
+            int status;
+            if (waitpid(workers[shard].pid, &status, WNOHANG) == workers[shard].pid) {
+                cerr << "Shard worker " << shard << " exited before it was ready." << endl;
+                workers[shard].pid = -1;
+                return false;
+            }
+            usleep(20000);
+        }
+    }
+    return true;
+}
+
+// Precondition: The worker's process is running.
+// Postcondition: Returns true if the router is now connected to the worker's socket and watches it.
+bool ShardRouter::connectWorker(Worker& worker) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, worker.socketPath.c_str(), sizeof(address.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        if (fd >= 0)
+            ::close(fd);
+        return false;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+    worker.fd = fd;
+    worker.events = EPOLLIN;
+    return true;
+}
+
+// Precondition: None.
+// Postcondition: Every worker still running is sent SIGTERM and waited for; their connections are closed and
+// their socket files removed, also for a worker that was killed.
+void ShardRouter::stopWorkers() {
+    for (Worker& worker : workers) {
+        if (worker.fd >= 0)
+            ::close(worker.fd);
+        worker.fd = -1;
+        if (worker.pid > 0)
+            kill(worker.pid, SIGTERM);
+    }
+    for (Worker& worker : workers) {
+        if (worker.pid > 0) {
+            waitpid(worker.pid, nullptr, 0);
+            unlink(worker.socketPath.c_str());
+        }
+        worker.pid = -1;
+    }
+}
+
+// Precondition: `path` is a writable location; a socket file left there by an earlier run is replaced.
+// Postcondition: Returns true if the router now listens on the Unix domain socket `path`.
+bool ShardRouter::listenUnix(const string& path) {
+    int fd = bindUnixSocket(path);
+    if (fd < 0) return false;
+    unixPath = path;
+    return startListening(fd);
+}
+
+// Precondition: 0 < `port` < 65536.
+// Postcondition: Returns true if the router now listens on 127.0.0.1:`port`.
+bool ShardRouter::listenTcp(int port) {
+    int fd = bindTcpSocket(port);
+    return fd >= 0 && startListening(fd);
+}
+
+// Precondition: `fd` is a bound, non-blocking socket.
+// Postcondition: Returns true if `fd` listens and the event loop watches it for new connections.
+bool ShardRouter::startListening(int fd) {
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (listen(fd, SOMAXCONN) != 0 || epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+        cerr << "Cannot listen: " << strerror(errno) << endl;
+        ::close(fd);
+        return false;
+    }
+    listenFd = fd;
+    return true;
+}
+
+// Precondition: startWorkers() and listenUnix() or listenTcp() returned true.
+// Postcondition: Routes requests until SIGINT or SIGTERM arrives or a worker goes away; returns false in the
+// second case. Every round reads all ready sockets, queues the routed lines per worker, and then sends each
+// worker its lines and each client its completed responses with as few writes as the sockets accept.
+bool ShardRouter::run() {
+    epoll_event events[256];
+    while (!stopping) {
+        int ready = epoll_wait(epollFd, events, 256, -1);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready < 0) {
+            cerr << "epoll_wait failed: " << strerror(errno) << endl;
+            return false;
+        }
+        for (int i = 0; i < ready && !stopping; i++) {
+            int fd = events[i].data.fd;
+            if (fd == listenFd) {
+                acceptConnections();
+                continue;
+            }
+            if (fd == signalFd) {
+                stopping = true;
+                continue;
+            }
+            int shard = -1;
+            for (size_t j = 0; j < workers.size(); j++) {
+                if (workers[j].fd == fd)
+                    shard = static_cast<int>(j);
+            }
+            if (shard >= 0) {
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                    receiveFromWorker(shard);
+                if (events[i].events & EPOLLOUT)
+                    sendToWorker(workers[shard]);
+                continue;
+            }
+            auto found = clients.find(fd);
+            if (found == clients.end()) continue;
+            Client& client = *found->second;
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                receive(client);
+            if (events[i].events & EPOLLOUT) {
+                send(client);
+                closeIfDone(client);
+            }
+        }
+        for (Worker& worker : workers)
+            sendToWorker(worker);
+        vector<Client*> served;
+        served.swap(round);
+        for (Client* client : served) {
+            client->touched = false;
+            deliver(*client);
+            send(*client);
+            closeIfDone(*client);
+        }
+    }
+    return !workerLost;
+}
+
+// Precondition: The listening socket is readable.
+// Postcondition: Every pending connection is accepted, made non-blocking and watched for input.
+void ShardRouter::acceptConnections() {
+    while (true) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && errno != ECONNABORTED)
+                cerr << "accept failed: " << strerror(errno) << endl;
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            return;
+        }
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            ::close(fd);
+            continue;
+        }
+        unique_ptr<Client> client(new Client());
+        client->fd = fd;
+        client->events = EPOLLIN;
+        clients[fd] = move(client);
+    }
+}
+
+// Precondition: `client` is open.
+// Postcondition: Up to READ_BYTES_PER_ROUND bytes are read and every complete line is routed. End of input
+// (or a reset) marks the peer closed.
+void ShardRouter::receive(Client& client) {
+    char block[64 * 1024];
+    size_t received = 0;
+    while (!client.peerClosed && received < READ_BYTES_PER_ROUND) {
+        ssize_t count = recv(client.fd, block, sizeof(block), 0);
+        if (count > 0) {
+            client.input.append(block, static_cast<size_t>(count));
+            received += static_cast<size_t>(count);
+        } else if (count == 0) {
+            client.peerClosed = true;
+        } else if (errno == EINTR) {
+            continue;
+        } else {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                client.peerClosed = true;
+                client.output.clear();
+                client.sent = 0;
+            }
+            break;
+        }
+    }
+    parseRequests(client);
+    if (!client.touched) {
+        client.touched = true;
+        round.push_back(&client);
+    }
+}
+
+// Precondition: None.
+// Postcondition: Every complete line of the client's input is parsed and routed, or answered right away when
+// it needs no shard; a trailing partial line is kept (and completed if the peer has closed). A line longer
+// than MAX_LINE_BYTES is answered with an error and the client is closed once its responses are sent.
+void ShardRouter::parseRequests(Client& client) {
+    if (client.peerClosed && !client.input.empty() && client.input.back() != '\n')
+        client.input += '\n';
+    size_t last = client.input.rfind('\n');
+    if (last == string::npos) {
+        if (client.input.size() > MAX_LINE_BYTES) {
+            answerLocally(client, "ERROR line too long\n");
+            client.input.clear();
+            client.peerClosed = true;
+        }
+        return;
+    }
+    LineScanner scanner(client.input.data(), client.input.data() + last + 1);
+    Transaction transaction;
+    while (scanner.nextLine()) {
+        if (scanner.atLineEnd()) continue;
+        LineScanner keyword = scanner;
+        const char* fieldBegin;
+        const char* fieldEnd;
+        keyword.nextField(fieldBegin, fieldEnd);
+        if (string_view(fieldBegin, fieldEnd - fieldBegin) != "REPORT") {
+            if (parseTransaction(scanner, transaction))
+                route(client, transaction);
+            else
+                answerLocally(client, "ERROR expected REGISTER|CANCEL <id> <name> <code>, QUERY <id> <name>, "
+                                      "OVERLAP <code> <code> or REPORT [<code>]\n");
+            continue;
+        }
+        if (!keyword.nextField(fieldBegin, fieldEnd)) {
+            Pending& pending = expect(client, Pending::REPORT_ALL, catalog.getShardCount());
+            for (int shard = 0; shard < catalog.getShardCount(); shard++)
+                forward(pending, shard, shard, "REPORT\n");
+            continue;
+        }
+        string_view code(fieldBegin, fieldEnd - fieldBegin);
+        int courseId = catalog.find(code);
+        if (!keyword.atLineEnd())
+            answerLocally(client, "ERROR expected REPORT [<code>]\n");
+        else if (courseId == CourseIndex::NOT_FOUND)
+            answerLocally(client, "ERROR no such course\n");
+        else
+            forward(expect(client, Pending::FORWARD, 1), catalog.getShard(courseId), 0, "REPORT " + string(code) + "\n");
+    }
+    client.input.erase(0, last + 1);
+}
+
+// Precondition: `transaction` was parsed from one of the client's lines.
+// Postcondition: The request is queued for the shard that owns its course (every shard for QUERY), or
+// answered right away when its course is unknown. An OVERLAP of courses on two shards asks each shard for
+// its course's listing instead.
+void ShardRouter::route(Client& client, const Transaction& transaction) {
+    string line;
+    appendRequest(transaction, line);
+    if (transaction.op == Operation::QUERY) {
+        Pending& pending = expect(client, Pending::QUERY, catalog.getShardCount());
+        pending.prefix = "QUERY " + to_string(transaction.studentId) + " " + transaction.name + " ";
+        for (int shard = 0; shard < catalog.getShardCount(); shard++)
+            forward(pending, shard, shard, line);
+        return;
+    }
+    int courseId = catalog.find(transaction.code);
+    int otherId = transaction.op == Operation::OVERLAP ? catalog.find(transaction.otherCode) : courseId;
+    if (courseId == CourseIndex::NOT_FOUND || otherId == CourseIndex::NOT_FOUND) {
+        TransactionResult result{Outcome::NO_SUCH_COURSE, false, {}};
+        formatResult(transaction, result, nullptr, formatted);
+        string response;
+        formatted.drainTo(response);
+        answerLocally(client, move(response));
+    } else if (catalog.getShard(courseId) != catalog.getShard(otherId)) {
+        Pending& pending = expect(client, Pending::OVERLAP, 2);
+        pending.prefix = line;
+        pending.prefix.back() = ' ';
+        forward(pending, catalog.getShard(courseId), 0, "REPORT " + transaction.code + "\n");
+        forward(pending, catalog.getShard(otherId), 1, "REPORT " + transaction.otherCode + "\n");
+    } else {
+        forward(expect(client, Pending::FORWARD, 1), catalog.getShard(courseId), 0, line);
+    }
+}
+
+// Precondition: None.
+// Postcondition: `response` is queued as the client's next answer, after every earlier request's.
+void ShardRouter::answerLocally(Client& client, string response) {
+    Pending& pending = expect(client, Pending::LOCAL, 1);
+    pending.parts[0] = move(response);
+    complete(pending);
+}
+
+// Precondition: None.
+// Postcondition: Returns a new request of the client, answered after every earlier one, that waits for
+// `parts` shard responses (none for LOCAL).
+ShardRouter::Pending& ShardRouter::expect(Client& client, Pending::Kind kind, int parts) {
+    int waiting = kind == Pending::LOCAL ? 0 : parts;
+    client.pending.emplace_back(new Pending{&client, kind, waiting, vector<string>(parts), string()});
+    return *client.pending.back();
+}
+
+// Precondition: `line` is one request line for a RegistrationServer and 0 <= `part` < pending.parts.size().
+// Postcondition: `line` is queued for the shard, whose response will be stored as part `part` of `pending`.
+void ShardRouter::forward(Pending& pending, int shard, int part, const string& line) {
+    Worker& worker = workers[shard];
+    worker.output += line;
+    worker.expected.emplace_back(&pending, part);
+}
+
+// Precondition: The worker's socket is readable.
+// Postcondition: Every complete response is stored as its request's part: one line, or a "REPORT <bytes>"
+// line and that many bytes. A worker that closes its connection stops the router.
+void ShardRouter::receiveFromWorker(int shard) {
+    Worker& worker = workers[shard];
+    char block[64 * 1024];
+    while (true) {
+        ssize_t count = recv(worker.fd, block, sizeof(block), 0);
+        if (count > 0) {
+            worker.input.append(block, static_cast<size_t>(count));
+            continue;
+        }
+        if (count < 0 && errno == EINTR) continue;
+        if (count == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            cerr << "Shard worker " << shard << " closed its connection; stopping." << endl;
+            stopping = true;
+            workerLost = true;
+            return;
+        }
+        break;
+    }
+    size_t consumed = 0;
+    while (consumed < worker.input.size() && !worker.expected.empty()) {
+        Pending& pending = *worker.expected.front().first;
+        string& part = pending.parts[worker.expected.front().second];
+        if (worker.bodyLeft > 0) {
+            size_t take = min(worker.bodyLeft, worker.input.size() - consumed);
+            part.append(worker.input, consumed, take);
+            consumed += take;
+            worker.bodyLeft -= take;
+        } else {
+            size_t lineEnd = worker.input.find('\n', consumed);
+            if (lineEnd == string::npos) break;
+            part.assign(worker.input, consumed, lineEnd + 1 - consumed);
+            consumed = lineEnd + 1;
+            if (part.compare(0, 7, "REPORT ") == 0)
+                worker.bodyLeft = strtoull(part.c_str() + 7, nullptr, 10);
+        }
+        if (worker.bodyLeft == 0) {
+            worker.expected.pop_front();
+            if (--pending.waiting == 0)
+                complete(pending);
+        }
+    }
+    worker.input.erase(0, consumed);
+}
+
+// Precondition: `pending` has every response it waits for.
+// Postcondition: The client is scheduled to receive its completed responses this round.
+void ShardRouter::complete(Pending& pending) {
+    Client& client = *pending.client;
+    if (!client.touched) {
+        client.touched = true;
+        round.push_back(&client);
+    }
+}
+
+// Precondition: None.
+// Postcondition: Every answered request at the front of the client's queue is formatted onto its output,
+// merging the shards' parts for QUERY and a full REPORT. Responses to a closed peer are dropped.
+void ShardRouter::deliver(Client& client) {
+    while (!client.pending.empty() && client.pending.front()->waiting == 0) {
+        const Pending& pending = *client.pending.front();
+        if (pending.kind == Pending::QUERY)
+            client.output += mergeSchedules(pending);
+        else if (pending.kind == Pending::REPORT_ALL)
+            client.output += mergeReports(pending);
+        else if (pending.kind == Pending::OVERLAP)
+            client.output += countOverlap(pending);
+        else
+            client.output += pending.parts[0];
+        client.pending.pop_front();
+    }
+    if (client.peerClosed && client.output.empty())
+        client.sent = 0;
+}
+
+// Precondition: Every part of `pending` is a shard's QUERY response.
+// Postcondition: Returns one QUERY response listing the student's courses from every shard in catalog order,
+// the same line a single server holding every course would give; a shard's error line is passed on as is.
+string ShardRouter::mergeSchedules(const Pending& pending) const {
+    vector<pair<int, bool>> schedule;       // (catalog id, waitlisted)
+    for (const string& part : pending.parts) {
+        if (part.compare(0, pending.prefix.size(), pending.prefix) != 0
+            || part.compare(pending.prefix.size(), 2, "R:") != 0)
+            return part;
+        size_t waitlist = part.find(" W:", pending.prefix.size());
+        if (waitlist == string::npos)
+            return part;
+        for (int group = 0; group < 2; group++) {
+            size_t position = group == 0 ? pending.prefix.size() + 2 : waitlist + 3;
+            size_t end = group == 0 ? waitlist : part.size() - 1;
+            while (position < end) {
+                size_t comma = min(part.find(',', position), end);
+                int courseId = catalog.find(string_view(part.data() + position, comma - position));
+                if (courseId != CourseIndex::NOT_FOUND)
+                    schedule.emplace_back(courseId, group == 1);
+                position = comma + 1;
+            }
+        }
+    }
+    sort(schedule.begin(), schedule.end());
+    string response = pending.prefix;
+    for (int group = 0; group < 2; group++) {
+        response += group == 0 ? "R:" : " W:";
+        bool first = true;
+        for (const pair<int, bool>& entry : schedule) {
+            if (entry.second != (group == 1)) continue;
+            if (!first) response += ',';
+            response += catalog.getCode(entry.first);
+            first = false;
+        }
+    }
+    response += '\n';
+    return response;
+}
+
+// Precondition: The two parts of `pending` are the REPORT responses for the OVERLAP's two courses.
+// Postcondition: Returns the OVERLAP response a single server holding every course would give. A student is
+// one id and name, which is how the listings show each enrolled or waiting student, once per course. Every
+// non-blank line after the "----" rule is a student line except the "  <  Waitlist" header, whatever the id.
+string ShardRouter::countOverlap(const Pending& pending) const {
+    unordered_set<string> firstStudents;
+    int sizes[2] = {0, 0};
+    int both = 0;
+    string key;
+    for (int part = 0; part < 2; part++) {
+        const string& listing = pending.parts[part];
+        if (listing.compare(0, 7, "REPORT ") != 0)
+            return listing;
+        bool inStudents = false;
+        for (size_t lineBegin = listing.find('\n') + 1; lineBegin < listing.size();) {
+            size_t lineEnd = min(listing.find('\n', lineBegin), listing.size());
+            if (!inStudents) {
+                inStudents = listing.compare(lineBegin, 4, "----") == 0;
+            }
+            else if (lineEnd != lineBegin && listing.compare(lineBegin, 13, "  <  Waitlist") != 0) {
+                size_t idEnd = listing.find(' ', lineBegin);
+                size_t nameBegin = listing.find_first_not_of(' ', idEnd);
+                size_t nameEnd = min(listing.find(' ', nameBegin), lineEnd);
+                key.assign(listing, lineBegin, idEnd - lineBegin);
+                key += ' ';
+                key.append(listing, nameBegin, nameEnd - nameBegin);
+                sizes[part]++;
+                if (part == 0)
+                    firstStudents.insert(key);
+                else
+                    both += firstStudents.count(key) != 0;
+            }
+            lineBegin = lineEnd + 1;
+        }
+    }
+    return pending.prefix + "BOTH:" + to_string(both) + " EITHER:" + to_string(sizes[0] + sizes[1] - both) + '\n';
+}
+
+// Precondition: Every part of `pending` is a shard's full REPORT response.
+// Postcondition: Returns one REPORT response with every course section in catalog order, the same bytes a
+// single server holding every course would send. Each shard lists its own courses in catalog order, and a
+// section starts at a line beginning with "[ ", which no student line does.
+string ShardRouter::mergeReports(const Pending& pending) const {
+    int shardCount = catalog.getShardCount();
+    vector<vector<string_view>> sections(shardCount);
+    size_t bytes = 0;
+    for (int shard = 0; shard < shardCount; shard++) {
+        const string& part = pending.parts[shard];
+        size_t bodyBegin = part.find('\n') + 1;
+        if (part.compare(0, 7, "REPORT ") != 0 || bodyBegin == 0)
+            return part;
+        bytes += part.size() - bodyBegin;
+        size_t sectionBegin = bodyBegin;
+        for (size_t position = part.find("\n[ ", bodyBegin); position != string::npos;
+             position = part.find("\n[ ", position + 1)) {
+            sections[shard].emplace_back(part.data() + sectionBegin, position + 1 - sectionBegin);
+            sectionBegin = position + 1;
+        }
+        if (sectionBegin < part.size())
+            sections[shard].emplace_back(part.data() + sectionBegin, part.size() - sectionBegin);
+        if (static_cast<int>(sections[shard].size()) != catalog.shardSize(shard))
+            return "ERROR shard " + to_string(shard) + " report does not match the catalog\n";
+    }
+    string response = "REPORT " + to_string(bytes) + '\n';
+    response.reserve(response.size() + bytes);
+    for (int courseId = 0; courseId < catalog.getCourseCount(); courseId++)
+        response += sections[catalog.getShard(courseId)][catalog.getLocalId(courseId)];
+    return response;
+}
+
+// Precondition: None.
+// Postcondition: As much of the worker's queued lines as its socket accepts is sent; epoll reports
+// writability while some remain.
+void ShardRouter::sendToWorker(Worker& worker) {
+    if (worker.fd < 0) return;
+    while (worker.sent < worker.output.size()) {
+        ssize_t count = ::send(worker.fd, worker.output.data() + worker.sent, worker.output.size() - worker.sent,
+                               MSG_NOSIGNAL);
+        if (count > 0)
+            worker.sent += static_cast<size_t>(count);
+        else if (count < 0 && errno == EINTR)
+            continue;
+        else
+            break;
+    }
+    if (worker.sent == worker.output.size()) {
+        worker.output.clear();
+        worker.sent = 0;
+    }
+    uint32_t wanted = EPOLLIN;
+    if (!worker.output.empty())
+        wanted |= EPOLLOUT;
+    watch(worker.fd, worker.events, wanted);
+}
+
+// Precondition: `client` is open.
+// Postcondition: As much queued output as the socket accepts is sent; epoll reads the client while it has
+// fewer than MAX_IN_FLIGHT requests awaiting answers and less than MAX_PENDING_OUTPUT bytes waiting to be sent.
+void ShardRouter::send(Client& client) {
+    while (client.sent < client.output.size()) {
+        ssize_t count = ::send(client.fd, client.output.data() + client.sent, client.output.size() - client.sent,
+                               MSG_NOSIGNAL);
+        if (count > 0) {
+            client.sent += static_cast<size_t>(count);
+        } else if (count < 0 && errno == EINTR) {
+            continue;
+        } else {
+            if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                client.peerClosed = true;
+                client.output.clear();
+                client.sent = 0;
+            }
+            break;
+        }
+    }
+    if (client.sent == client.output.size()) {
+        client.output.clear();
+        client.sent = 0;
+    } else if (client.sent >= MAX_PENDING_OUTPUT) {
+        client.output.erase(0, client.sent);
+        client.sent = 0;
+    }
+    size_t waiting = client.output.size() - client.sent;
+    uint32_t wanted = 0;
+    if (!client.peerClosed && client.pending.size() < MAX_IN_FLIGHT && waiting < MAX_PENDING_OUTPUT)
+        wanted |= EPOLLIN;
+    if (waiting > 0)
+        wanted |= EPOLLOUT;
+    watch(client.fd, client.events, wanted);
+}
+
+// Precondition: `fd` is registered with epoll for `events`.
+// Postcondition: epoll watches `fd` for `wanted`, and `events` says so.
+void ShardRouter::watch(int fd, uint32_t& events, uint32_t wanted) {
+    if (wanted == events) return;
+    epoll_event event{};
+    event.events = wanted;
+    event.data.fd = fd;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event);
+    events = wanted;
+}
+
+// Precondition: `client` is not in this round's list.
+// Postcondition: The client is closed and forgotten if its peer has closed, every request is answered and
+// every response is sent.
+void ShardRouter::closeIfDone(Client& client) {
+    if (client.touched || !client.peerClosed || !client.pending.empty() || client.sent < client.output.size())
+        return;
+    int fd = client.fd;
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    clients.erase(fd);
+}
@@ -0,0 +1,114 @@
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <sys/types.h>
+#include "batch.h"
+#include "shard_catalog.h"
+using namespace std;
+
+// Serves the RegistrationServer protocol for a catalog split over several shard worker processes. Each worker
+// is a --shard-worker process: a RegistrationServer over its own shard's courses, listening on a Unix socket
+// of its own. The router holds one pipelined connection per worker and a single epoll loop over every client
+// and worker socket; it never touches a roster itself.
+//
+// REGISTER, CANCEL and REPORT <code> go to the shard that owns the course. QUERY goes to every shard and the
+// schedules are merged in catalog order; a full REPORT goes to every shard and the course sections are put
+// back in catalog order. OVERLAP goes to the owning shard when both courses share one; otherwise each shard
+// sends its course's listing and the router counts the students in both. Lines for one worker keep their
+// arrival order on its connection, so every client still sees its own requests applied in order, and gets
+// its responses in order.
+class ShardRouter {
+private:
+    struct Client;
+
+    // One client request and what the shards have answered so far
+    struct Pending {
+        enum Kind { LOCAL, FORWARD, QUERY, REPORT_ALL, OVERLAP };
+        Client* client;
+        Kind kind;
+        int waiting;                // shard responses still to come
+        vector<string> parts;       // LOCAL: the response; FORWARD: the shard's; QUERY, REPORT_ALL: one per shard;
+                                    // OVERLAP: the two courses' listings
+        string prefix;              // QUERY: "QUERY <id> <name> "; OVERLAP: "OVERLAP <code> <code> "
+    };
+
+    struct Client {
+        int fd;
+        string input;               // received bytes not yet parsed
+        string output;              // responses not yet sent
+        size_t sent = 0;
+        uint32_t events = 0;
+        bool peerClosed = false;
+        bool touched = false;       // a response completed this round
+        deque<unique_ptr<Pending>> pending;     // in request order; answered from the front
+    };
+
+    // The connection to one shard worker
+    struct Worker {
+        pid_t pid = -1;
+        string socketPath;
+        int fd = -1;
+        string input;
+        string output;
+        size_t sent = 0;
+        uint32_t events = 0;
+        deque<pair<Pending*, int>> expected;    // the request and part each coming response answers
+        size_t bodyLeft = 0;                    // bytes of a REPORT listing still to come
+    };
+
+    const ShardCatalog& catalog;
+    int epollFd;
+    int listenFd;
+    int signalFd;
+    string unixPath;
+    unordered_map<int, unique_ptr<Client>> clients;
+    vector<Worker> workers;
+    vector<Client*> round;      // clients with a response completed this round
+    OutputBuffer formatted;
+    bool stopping;
+    bool workerLost;
+
+    bool startListening(int fd);
+    bool connectWorker(Worker& worker);
+    void acceptConnections();
+    void receive(Client& client);
+    void parseRequests(Client& client);
+    void route(Client& client, const Transaction& transaction);
+    void answerLocally(Client& client, string response);
+    Pending& expect(Client& client, Pending::Kind kind, int parts);
+    void forward(Pending& pending, int shard, int part, const string& line);
+    void receiveFromWorker(int shard);
+    void complete(Pending& pending);
+    void deliver(Client& client);
+    string mergeSchedules(const Pending& pending) const;
+    string mergeReports(const Pending& pending) const;
+    string countOverlap(const Pending& pending) const;
+    void sendToWorker(Worker& worker);
+    void send(Client& client);
+    void watch(int fd, uint32_t& events, uint32_t wanted);
+    void closeIfDone(Client& client);
+public:
+    static const size_t MAX_LINE_BYTES = 64 * 1024;
+    static const size_t READ_BYTES_PER_ROUND = 256 * 1024;
+    static const size_t MAX_PENDING_OUTPUT = 4 * 1024 * 1024;
+    static const size_t MAX_IN_FLIGHT = 16 * 1024;     // requests per client awaiting an answer
+    ShardRouter(const ShardCatalog& catalog);
+    ~ShardRouter();
+    ShardRouter(const ShardRouter&) = delete;
+    ShardRouter& operator=(const ShardRouter&) = delete;
+    bool startWorkers(const string& segmentName, const string& enrollmentFile, const string& stateDirectory,
+                      const vector<string>& workerOptions);
+    bool listenUnix(const string& path);
+    bool listenTcp(int port);
+    bool run();
+    void stopWorkers();
+};
+
+#endif //ROUTER_H
@@ -0,0 +1,508 @@
+// Registration server: an epoll loop that serves pipelined request lines from many local clients.
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "course_index.h"
+#include "engine.h"
+#include "mapped_file.h"
+#include "report.h"
+#include "server.h"
+
+using namespace std;
+
+// Precondition: None.
+// Postcondition: Returns the signals that stop the server (and the shard router).
+sigset_t stopSignals() {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    return signals;
+}
+
+// RegistrationServer class
+// Constructor
+// Precondition: `engine`, `snapshots` and `index` were built over the `courseCount` courses of `courseList`,
+// `snapshots` is attached to `engine`, and blockStopSignals() ran before any thread was started.
+// Postcondition: The event loop is set up and watches for SIGINT/SIGTERM, and the report thread is waiting
+// for work; nothing is listening yet.
+RegistrationServer::RegistrationServer(RegistrationEngine& engine, SnapshotStore& snapshots, const Course* courseList,
+                                       int courseCount, const CourseIndex& index)
+        : engine(engine), snapshots(snapshots), courseList(courseList), courseCount(courseCount), index(index),
+          listenFd(-1), reportCache(ReportFormat::TEXT), reportStopping(false) {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    sigset_t signals = stopSignals();
+    signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    reportEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    for (int fd : {signalFd, reportEventFd}) {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+    }
+    reportThread = thread(&RegistrationServer::reportLoop, this);
+}
+
+// Destructor
+// Precondition: None.
+// Postcondition: The report thread is stopped (unanswered reports are dropped), every connection and the
+// listening socket are closed, and the Unix socket file is removed.
+RegistrationServer::~RegistrationServer() {
+    {
+        lock_guard<mutex> guard(reportLock);
+        reportStopping = true;
+    }
+    reportReady.notify_one();
+    reportThread.join();
+    reportJobs.clear();
+    for (auto& entry : connections)
+        ::close(entry.first);
+    if (listenFd >= 0)
+        ::close(listenFd);
+    if (!unixPath.empty())
+        unlink(unixPath.c_str());
+    ::close(signalFd);
+    ::close(reportEventFd);
+    ::close(epollFd);
+}
+
+// Precondition: Called at the start of main, before any other thread exists.
+// Postcondition: SIGINT and SIGTERM are blocked in this thread and every thread it starts, so they are only
+// seen by the server's signalfd and shut it down cleanly.
+void RegistrationServer::blockStopSignals() {
+    sigset_t signals = stopSignals();
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+}
+
+// Precondition: `path` is a writable location; a socket file left there by an earlier run is replaced.
+// Postcondition: Returns a non-blocking socket bound to the Unix domain socket `path`, or -1.
+int bindUnixSocket(const string& path) {
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+        cerr << "Socket path " << path << " is too long." << endl;
+        return -1;
+    }
+    struct stat existing;
+    if (stat(path.c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode))
+        unlink(path.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        cerr << "Cannot listen on " << path << ": " << strerror(errno) << endl;
+        if (fd >= 0)
+            ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Precondition: 0 < `port` < 65536.
+// Postcondition: Returns a non-blocking socket bound to 127.0.0.1:`port`, or -1.
+int bindTcpSocket(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int on = 1;
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0
+        || bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        cerr << "Cannot listen on 127.0.0.1:" << port << ": " << strerror(errno) << endl;
+        if (fd >= 0)
+            ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Precondition: `path` is a writable location; a socket file left there by an earlier run is replaced.
+// Postcondition: Returns true if the server now listens on the Unix domain socket `path`.
+bool RegistrationServer::listenUnix(const string& path) {
+    int fd = bindUnixSocket(path);
+    if (fd < 0) return false;
+    unixPath = path;
+    return startListening(fd);
+}
+
+// Precondition: 0 < `port` < 65536.
+// Postcondition: Returns true if the server now listens on 127.0.0.1:`port`.
+bool RegistrationServer::listenTcp(int port) {
+    int fd = bindTcpSocket(port);
+    return fd >= 0 && startListening(fd);
+}
+
+// Precondition: `fd` is a bound, non-blocking socket.
+// Postcondition: Returns true if `fd` listens and the event loop watches it for new connections.
+bool RegistrationServer::startListening(int fd) {
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (listen(fd, SOMAXCONN) != 0 || epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+        cerr << "Cannot listen: " << strerror(errno) << endl;
+        ::close(fd);
+        return false;
+    }
+    listenFd = fd;
+    return true;
+}
+
+// Precondition: listenUnix() or listenTcp() returned true.
+// Postcondition: Serves clients until SIGINT or SIGTERM arrives. Every round handles all ready sockets,
+// then answers everything that arrived in that round at once (see serveRound()).
+void RegistrationServer::run() {
+    epoll_event events[256];
+    bool stopping = false;
+    while (!stopping) {
+        int ready = epoll_wait(epollFd, events, 256, -1);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready < 0) {
+            cerr << "epoll_wait failed: " << strerror(errno) << endl;
+            return;
+        }
+        for (int i = 0; i < ready; i++) {
+            int fd = events[i].data.fd;
+            if (fd == listenFd) {
+                acceptConnections();
+                continue;
+            }
+            if (fd == signalFd) {
+                stopping = true;
+                continue;
+            }
+            if (fd == reportEventFd) {
+                finishReports();
+                continue;
+            }
+            auto found = connections.find(fd);
+            if (found == connections.end()) continue;
+            Connection& connection = *found->second;
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                receive(connection);
+            if (events[i].events & EPOLLOUT) {
+                send(connection);
+                closeIfDone(connection);
+            }
+        }
+        serveRound();
+    }
+}
+
+// Precondition: The listening socket is readable.
+// Postcondition: Every pending connection is accepted, made non-blocking and watched for input.
+void RegistrationServer::acceptConnections() {
+    while (true) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && errno != ECONNABORTED)
+                cerr << "accept failed: " << strerror(errno) << endl;
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            return;
+        }
+        // Responses are already batched, so send them as soon as they are written
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            ::close(fd);
+            continue;
+        }
+        unique_ptr<Connection> connection(new Connection());
+        connection->fd = fd;
+        connection->events = EPOLLIN;
+        connections[fd] = move(connection);
+    }
+}
+
+// Precondition: `connection` is open.
+// Postcondition: Up to READ_BYTES_PER_ROUND bytes are appended to the connection's input, and the connection
+// joins this round. End of input (or a reset) marks the peer closed.
+void RegistrationServer::receive(Connection& connection) {
+    char block[64 * 1024];
+    size_t received = 0;
+    while (!connection.peerClosed && received < READ_BYTES_PER_ROUND) {
+        ssize_t count = recv(connection.fd, block, sizeof(block), 0);
+        if (count > 0) {
+            connection.input.append(block, static_cast<size_t>(count));
+            received += static_cast<size_t>(count);
+        } else if (count == 0) {
+            connection.peerClosed = true;
+        } else if (errno == EINTR) {
+            continue;
+        } else {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                connection.peerClosed = true;
+                connection.output.clear();
+                connection.sent = 0;
+            }
+            break;
+        }
+    }
+    if (!connection.inRound) {
+        connection.inRound = true;
+        round.push_back(&connection);
+    }
+}
+
+// Precondition: The connection has no REPORT pending.
+// Postcondition: Every complete line of the connection's input up to and including its first valid REPORT
+// becomes a Request; the lines after that REPORT and a trailing partial line are kept for a later round (a
+// partial line is completed if the peer has closed). A line longer than MAX_LINE_BYTES is answered with an
+// error and the connection is closed once its responses are sent.
+void RegistrationServer::parseRequests(Connection& connection) {
+    if (connection.peerClosed && !connection.input.empty() && connection.input.back() != '\n')
+        connection.input += '\n';
+    size_t last = connection.input.rfind('\n');
+    if (last == string::npos) {
+        if (connection.input.size() > MAX_LINE_BYTES) {
+            requests.push_back(Request{&connection, Request::ERROR, Transaction(), 0, "line too long"});
+            connection.input.clear();
+            connection.peerClosed = true;
+        }
+        return;
+    }
+    size_t consumed = last + 1;
+    LineScanner scanner(connection.input.data(), connection.input.data() + consumed);
+    while (scanner.nextLine()) {
+        if (scanner.atLineEnd()) continue;
+        Request request{&connection, Request::TRANSACTION, Transaction(), 0, nullptr};
+        // REPORT is read here; everything else is a batch-mode transaction
+        LineScanner keyword = scanner;
+        const char* fieldBegin;
+        const char* fieldEnd;
+        keyword.nextField(fieldBegin, fieldEnd);
+        if (string_view(fieldBegin, fieldEnd - fieldBegin) == "REPORT") {
+            request.kind = Request::REPORT;
+            request.courseId = ALL_COURSES;
+            if (keyword.nextField(fieldBegin, fieldEnd))
+                request.courseId = index.find(string_view(fieldBegin, fieldEnd - fieldBegin));
+            if (!keyword.atLineEnd()) {
+                request.kind = Request::ERROR;
+                request.error = "expected REPORT [<code>]";
+            } else if (request.courseId == CourseIndex::NOT_FOUND) {
+                request.kind = Request::ERROR;
+                request.error = "no such course";
+            }
+        } else if (!parseTransaction(scanner, request.transaction)) {
+            request.kind = Request::ERROR;
+            request.error = "expected REGISTER|CANCEL <id> <name> <code>, QUERY <id> <name>, OVERLAP <code> <code>"
+                            " or REPORT [<code>]";
+        }
+        bool report = request.kind == Request::REPORT;
+        requests.push_back(move(request));
+        if (report) {
+            // The rest waits until the report is answered
+            const char* inputEnd = connection.input.data() + last + 1;
+            const char* lineEnd = static_cast<const char*>(memchr(fieldBegin, '\n', inputEnd - fieldBegin));
+            consumed = lineEnd + 1 - connection.input.data();
+            break;
+        }
+    }
+    connection.input.erase(0, consumed);
+}
+
+// Precondition: None.
+// Postcondition: Every request that arrived since the last round on a connection without a pending REPORT is
+// answered or, for a REPORT, handed to the report thread; the responses are sent as far as the sockets
+// accept. All transactions of the round are applied as one engine batch, so a REPORT reflects its own
+// connection's earlier requests and everything else applied in the same round.
+void RegistrationServer::serveRound() {
+    if (round.empty()) return;
+    requests.clear();
+    for (Connection* connection : round) {
+        if (!connection->reportPending)
+            parseRequests(*connection);
+    }
+    answer(0, requests.size());
+    for (const Request& request : requests) {
+        if (request.kind == Request::REPORT)
+            startReport(request);
+    }
+    for (Connection* connection : round) {
+        connection->inRound = false;
+        send(*connection);
+    }
+    vector<Connection*> served;
+    served.swap(round);
+    for (Connection* connection : served)
+        closeIfDone(*connection);
+}
+
+// Precondition: None.
+// Postcondition: The transactions in requests[`first`, `last`) are applied through the engine in one batch
+// (made durable before any response is queued), and every request's
+// response except REPORT's is queued on its connection.
+void RegistrationServer::answer(size_t first, size_t last) {
+    transactions.clear();
+    for (size_t i = first; i < last; i++) {
+        if (requests[i].kind == Request::TRANSACTION)
+            transactions.push_back(move(requests[i].transaction));
+    }
+    if (!transactions.empty())
+        engine.executeAll(transactions, results, latencies);
+    size_t next = 0;
+    for (size_t i = first; i < last; i++) {
+        if (requests[i].kind == Request::REPORT) {
+            continue;
+        } else if (requests[i].kind == Request::TRANSACTION) {
+            formatResult(transactions[next], results[next], courseList, formatted);
+            next++;
+        } else {
+            formatted.append("ERROR ");
+            formatted.append(requests[i].error);
+            formatted.append('\n');
+        }
+        formatted.drainTo(requests[i].connection->output);
+    }
+}
+
+// Precondition: `request` is a REPORT for a known course or ALL_COURSES, every request before it has been
+// applied, and no transaction is running.
+// Postcondition: The courses changed since the last REPORT are published, the snapshot is pinned and handed
+// to the report thread with the request; the connection reads no further requests until finishReports()
+// queues the answer.
+void RegistrationServer::startReport(const Request& request) {
+    request.connection->reportPending = true;
+    snapshots.publish();
+    {
+        lock_guard<mutex> guard(reportLock);
+        reportJobs.push_back(ReportJob{request.connection, request.courseId, snapshots.read()});
+    }
+    reportReady.notify_one();
+}
+
+// Precondition: Runs on the report thread.
+// Postcondition: Renders each queued REPORT from its snapshot until the server is destroyed: the menu 4
+// listing behind a "REPORT <bytes>" line. Sections come from the report cache, so only courses changed since
+// the last REPORT are formatted again. The snapshot is released as soon as the text is done.
+void RegistrationServer::reportLoop() {
+    while (true) {
+        unique_lock<mutex> guard(reportLock);
+        reportReady.wait(guard, [this] { return reportStopping || !reportJobs.empty(); });
+        if (reportStopping) return;
+        Connection* connection;
+        string response;
+        {
+            ReportJob job = move(reportJobs.front());
+            reportJobs.pop_front();
+            guard.unlock();
+            const SnapshotStore::Reader& snapshot = job.snapshot;
+            int first = job.courseId == ALL_COURSES ? 0 : job.courseId;
+            int last = job.courseId == ALL_COURSES ? snapshot.courseCount() : job.courseId + 1;
+            if (job.courseId == ALL_COURSES)
+                reportCache.refresh(snapshot, engine.getThreadCount());
+            size_t bytes = 0;
+            for (int i = first; i < last; i++)
+                bytes += reportCache.section(snapshot.view(i)).size();
+            response = "REPORT " + to_string(bytes) + '\n';
+            response.reserve(response.size() + bytes);
+            for (int i = first; i < last; i++)
+                response += reportCache.section(snapshot.view(i));
+            connection = job.connection;
+        }
+        guard.lock();
+        reportsDone.emplace_back(connection, move(response));
+        guard.unlock();
+        uint64_t one = 1;
+        ssize_t written = write(reportEventFd, &one, sizeof(one));
+        (void)written;
+    }
+}
+
+// Precondition: The report thread signalled `reportEventFd`.
+// Postcondition: Every finished report is queued on its connection, and those connections join this round so
+// the requests that waited behind the report are served.
+void RegistrationServer::finishReports() {
+    uint64_t count;
+    ssize_t readCount = read(reportEventFd, &count, sizeof(count));
+    (void)readCount;
+    vector<pair<Connection*, string>> done;
+    {
+        lock_guard<mutex> guard(reportLock);
+        done.swap(reportsDone);
+    }
+    for (pair<Connection*, string>& report : done) {
+        Connection& connection = *report.first;
+        connection.output += report.second;
+        connection.reportPending = false;
+        if (!connection.inRound) {
+            connection.inRound = true;
+            round.push_back(&connection);
+        }
+    }
+}
+
+// Precondition: `connection` is open.
+// Postcondition: As much queued output as the socket accepts is sent; epoll is told to report writability
+// while output remains and to stop reading while more than MAX_PENDING_OUTPUT bytes wait to be sent.
+void RegistrationServer::send(Connection& connection) {
+    while (connection.sent < connection.output.size()) {
+        ssize_t count = ::send(connection.fd, connection.output.data() + connection.sent,
+                               connection.output.size() - connection.sent, MSG_NOSIGNAL);
+        if (count > 0) {
+            connection.sent += static_cast<size_t>(count);
+        } else if (count < 0 && errno == EINTR) {
+            continue;
+        } else {
+            if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                // The peer is gone; drop what it will never read
+                connection.peerClosed = true;
+                connection.output.clear();
+                connection.sent = 0;
+            }
+            break;
+        }
+    }
+    if (connection.sent == connection.output.size()) {
+        connection.output.clear();
+        connection.sent = 0;
+    } else if (connection.sent >= MAX_PENDING_OUTPUT) {
+        connection.output.erase(0, connection.sent);
+        connection.sent = 0;
+    }
+    watch(connection);
+}
+
+// Precondition: `connection` is open.
+// Postcondition: epoll watches the connection for input unless the peer has closed, a REPORT is pending or
+// too much output is waiting, and for writability while output is waiting.
+void RegistrationServer::watch(Connection& connection) {
+    size_t pending = connection.output.size() - connection.sent;
+    uint32_t wanted = 0;
+    if (!connection.peerClosed && !connection.reportPending && pending < MAX_PENDING_OUTPUT)
+        wanted |= EPOLLIN;
+    if (pending > 0)
+        wanted |= EPOLLOUT;
+    if (wanted == connection.events) return;
+    epoll_event event{};
+    event.events = wanted;
+    event.data.fd = connection.fd;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, connection.fd, &event);
+    connection.events = wanted;
+}
+
+// Precondition: `connection` is not in this round's list.
+// Postcondition: The connection is closed and forgotten if its peer has closed, no REPORT is pending and every
+// response is sent.
+void RegistrationServer::closeIfDone(Connection& connection) {
+    if (connection.inRound || connection.reportPending || !connection.peerClosed
+        || connection.sent < connection.output.size()) return;
+    int fd = connection.fd;
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    connections.erase(fd);
+}
@@ -0,0 +1,125 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "batch.h"
+#include "course_registration.h"
+#include "report.h"
+#include "snapshot.h"
+using namespace std;
+
+// Serves many registration front-ends from one in-memory course state, over a Unix domain socket or a
+// TCP port on 127.0.0.1. A single epoll loop owns every connection. Clients may pipeline requests: each
+// round, every complete line that has arrived on any connection is parsed, the transactions are applied
+// through the engine as one batch (one group commit when durable state is attached), and the responses
+// are queued per connection and sent with as few writes as the sockets accept.
+//
+// REPORT never holds up the loop: it pins the snapshot published after every request before it in the round
+// and is rendered on the report thread while registrations keep flowing. Until it is answered, its own
+// connection's later requests wait unread, so every connection still gets its responses in order.
+//
+// Protocol: one request per line; every request gets a response, in request order per connection.
+//   REGISTER|CANCEL <id> <name> <code>    menus 2 and 3: one result line, as in batch mode
+//   QUERY <id> <name>                     menu 1: "QUERY <id> <name> R:<codes> W:<codes>"
+//   OVERLAP <code> <code>                 "OVERLAP <code> <code> BOTH:<n> EITHER:<n>"
+//   REPORT [<code>]                       menu 4: "REPORT <bytes>" and a line break, followed by that many
+//                                         bytes of the listing for one course (or every course)
+// Anything else is answered with one "ERROR ..." line.
+class RegistrationServer {
+private:
+    struct Connection {
+        int fd;
+        string input;           // received bytes not yet parsed (at most a partial line between rounds)
+        string output;          // responses not yet sent
+        size_t sent = 0;        // bytes at the front of `output` already sent
+        uint32_t events = 0;    // what epoll currently watches for
+        bool peerClosed = false;
+        bool inRound = false;   // in this round's list of connections with new input
+        bool reportPending = false; // a REPORT is being rendered; later input waits until it is answered
+    };
+
+    // A REPORT handed to the report thread, with the snapshot it is rendered from
+    struct ReportJob {
+        Connection* connection;
+        int courseId;
+        SnapshotStore::Reader snapshot;
+    };
+
+    // One parsed request line of the current round
+    struct Request {
+        enum Kind { TRANSACTION, REPORT, ERROR };
+        Connection* connection;
+        Kind kind;
+        Transaction transaction;    // TRANSACTION only
+        int courseId;               // REPORT only: the course, or ALL_COURSES
+        const char* error;          // ERROR only: the reason
+    };
+
+    RegistrationEngine& engine;
+    SnapshotStore& snapshots;
+    const Course* courseList;
+    int courseCount;
+    const CourseIndex& index;
+    int epollFd;
+    int listenFd;
+    int signalFd;
+    string unixPath;            // removed again on shutdown
+    unordered_map<int, unique_ptr<Connection>> connections;
+    vector<Connection*> round;  // connections that received input since the last round
+    vector<Request> requests;
+    vector<Transaction> transactions;
+    vector<TransactionResult> results;
+    vector<uint32_t> latencies;
+    OutputBuffer formatted;
+    ReportCache reportCache;    // report thread only: renders just the courses changed since the last REPORT
+    thread reportThread;
+    mutex reportLock;
+    condition_variable reportReady;
+    deque<ReportJob> reportJobs;
+    vector<pair<Connection*, string>> reportsDone;
+    bool reportStopping;
+    int reportEventFd;          // signalled by the report thread when a response is done
+
+    bool startListening(int fd);
+    void acceptConnections();
+    void receive(Connection& connection);
+    void parseRequests(Connection& connection);
+    void serveRound();
+    void answer(size_t first, size_t last);
+    void startReport(const Request& request);
+    void reportLoop();
+    void finishReports();
+    void send(Connection& connection);
+    void watch(Connection& connection);
+    void closeIfDone(Connection& connection);
+public:
+    static const int ALL_COURSES = -2;
+    static const size_t MAX_LINE_BYTES = 64 * 1024;
+    static const size_t READ_BYTES_PER_ROUND = 256 * 1024;
+    static const size_t MAX_PENDING_OUTPUT = 4 * 1024 * 1024;
+    RegistrationServer(RegistrationEngine& engine, SnapshotStore& snapshots, const Course* courseList,
+                       int courseCount, const CourseIndex& index);
+    ~RegistrationServer();
+    RegistrationServer(const RegistrationServer&) = delete;
+    RegistrationServer& operator=(const RegistrationServer&) = delete;
+    static void blockStopSignals();
+    bool listenUnix(const string& path);
+    bool listenTcp(int port);
+    void run();
+};
+
+sigset_t stopSignals();
+int bindUnixSocket(const string& path);
+int bindTcpSocket(int port);
+
+#endif //SERVER_H
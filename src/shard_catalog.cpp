@@ -0,0 +1,259 @@
+// Shared-memory course catalog split into shards by course id.
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "course_index.h"
+#include "shard_catalog.h"
+#include "string_arena.h"
+
+using namespace std;
+
+const char ShardCatalog::MAGIC[8] = {'R', 'E', 'G', 'S', 'H', 'R', 'D', '1'};
+
+// ShardCatalog class
+// Constructor
+// Precondition: None.
+// Postcondition: Creates a catalog that is not mapped yet; use create() or attach().
+ShardCatalog::ShardCatalog()
+        : owner(false), base(nullptr), mappedBytes(0), header(nullptr), records(nullptr), slots(nullptr),
+          chars(nullptr) {}
+
+// Destructor
+// Precondition: None.
+// Postcondition: The segment is unmapped, and removed if this catalog created it.
+ShardCatalog::~ShardCatalog() {
+    release();
+}
+
+// Precondition: None.
+// Postcondition: The mapping is gone; the creator also unlinks the segment's name.
+void ShardCatalog::release() {
+    if (base != nullptr)
+        munmap(base, mappedBytes);
+    if (owner)
+        shm_unlink(name.c_str());
+    base = nullptr;
+    owner = false;
+}
+
+// Precondition: None.
+// Postcondition: Returns the shard that owns `courseId` among `shardCount` shards. The id is scrambled first,
+// so neighbouring courses (usually one department) spread over every shard.
+int ShardCatalog::shardOf(int courseId, int shardCount) {
+    uint64_t mixed = (static_cast<uint64_t>(courseId) + 1) * 0x9E3779B97F4A7C15ull;
+    return static_cast<int>(((mixed >> 32) * static_cast<uint64_t>(shardCount)) >> 32);
+}
+
+// Precondition: `base` maps a segment whose header has been checked.
+// Postcondition: The table pointers and per-shard course counts are set from the header.
+void ShardCatalog::locate() {
+    header = static_cast<const Header*>(base);
+    records = reinterpret_cast<const Record*>(header + 1);
+    slots = reinterpret_cast<const Slot*>(records + header->courseCount);
+    chars = reinterpret_cast<const char*>(slots + header->slotCount);
+    shardSizes.assign(header->shardCount, 0);
+    for (uint32_t i = 0; i < header->courseCount; i++)
+        shardSizes[records[i].shard]++;
+}
+
+// Member function
+// Precondition: `segmentName` starts with '/' and names no live segment; 1 <= `shardCount`.
+// Postcondition: Returns true if a segment named `segmentName` now holds the `courseCount` courses of
+// `courseList` split over `shardCount` shards. The catalog owns the segment and unlinks it when destroyed.
+bool ShardCatalog::create(const string& segmentName, const Course* courseList, int courseCount, int shardCount) {
+    release();
+    size_t slotCount = 8;
+    while (slotCount < static_cast<size_t>(courseCount) * 2)
+        slotCount *= 2;
+    size_t stringBytes = 0;
+    for (int i = 0; i < courseCount; i++)
+        stringBytes += courseList[i].getCode().size() + courseList[i].getTitle().size();
+    size_t total = sizeof(Header) + sizeof(Record) * courseCount + sizeof(Slot) * slotCount + stringBytes;
+
+    int fd = shm_open(segmentName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        cerr << "Cannot create shared memory segment " << segmentName << ": " << strerror(errno) << endl;
+        return false;
+    }
+    name = segmentName;
+    owner = true;
+    if (ftruncate(fd, static_cast<off_t>(total)) != 0
+        || (base = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        cerr << "Cannot size shared memory segment " << segmentName << ": " << strerror(errno) << endl;
+        base = nullptr;
+        ::close(fd);
+        release();
+        return false;
+    }
+    ::close(fd);
+    mappedBytes = total;
+
+    Header* head = static_cast<Header*>(base);
+    memcpy(head->magic, MAGIC, sizeof(MAGIC));
+    head->shardCount = static_cast<uint32_t>(shardCount);
+    head->courseCount = static_cast<uint32_t>(courseCount);
+    head->slotCount = slotCount;
+    head->totalBytes = total;
+    Record* table = reinterpret_cast<Record*>(head + 1);
+    Slot* hashSlots = reinterpret_cast<Slot*>(table + courseCount);
+    char* text = reinterpret_cast<char*>(hashSlots + slotCount);
+    for (size_t i = 0; i < slotCount; i++)
+        hashSlots[i] = Slot{0, CourseIndex::NOT_FOUND};
+    vector<int32_t> nextLocal(shardCount, 0);
+    uint32_t offset = 0;
+    for (int i = 0; i < courseCount; i++) {
+        string_view code = courseList[i].getCode();
+        string_view title = courseList[i].getTitle();
+        Record& record = table[i];
+        record.codeOffset = offset;
+        record.codeLength = static_cast<uint32_t>(code.size());
+        memcpy(text + offset, code.data(), code.size());
+        offset += record.codeLength;
+        record.titleOffset = offset;
+        record.titleLength = static_cast<uint32_t>(title.size());
+        memcpy(text + offset, title.data(), title.size());
+        offset += record.titleLength;
+        record.enrollSize = courseList[i].getEnrollSize();
+        record.waitSize = courseList[i].getWaitSize();
+        record.shard = shardOf(i, shardCount);
+        record.localId = nextLocal[record.shard]++;
+
+        // As in CourseIndex, the first course with a code wins
+        uint32_t hash = hashString(code);
+        size_t pos = hash & (slotCount - 1);
+        bool duplicate = false;
+        while (hashSlots[pos].courseId != CourseIndex::NOT_FOUND) {
+            const Record& other = table[hashSlots[pos].courseId];
+            if (hashSlots[pos].hash == hash && string_view(text + other.codeOffset, other.codeLength) == code) {
+                duplicate = true;
+                break;
+            }
+            pos = (pos + 1) & (slotCount - 1);
+        }
+        if (!duplicate)
+            hashSlots[pos] = Slot{hash, i};
+    }
+    locate();
+    return true;
+}
+
+// Precondition: None.
+// Postcondition: Returns true if the segment named `segmentName` is mapped read-only and holds a catalog.
+bool ShardCatalog::attach(const string& segmentName) {
+    release();
+    int fd = shm_open(segmentName.c_str(), O_RDONLY, 0);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Header)) {
+        cerr << "Cannot attach shared memory segment " << segmentName << "." << endl;
+        if (fd >= 0)
+            ::close(fd);
+        return false;
+    }
+    mappedBytes = static_cast<size_t>(info.st_size);
+    base = mmap(nullptr, mappedBytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        base = nullptr;
+        return false;
+    }
+    const Header* head = static_cast<const Header*>(base);
+    if (memcmp(head->magic, MAGIC, sizeof(MAGIC)) != 0 || head->totalBytes != mappedBytes || head->shardCount == 0) {
+        cerr << "Shared memory segment " << segmentName << " does not hold a course catalog." << endl;
+        release();
+        return false;
+    }
+    name = segmentName;
+    locate();
+    return true;
+}
+
+// Precondition: This catalog created its segment.
+// Postcondition: The segment's name is removed, so no process can attach any more; the segment itself lives
+// on until every process that mapped it has unmapped it.
+void ShardCatalog::unlinkName() {
+    if (owner)
+        shm_unlink(name.c_str());
+    owner = false;
+}
+
+// Getter
+// Precondition: The catalog is mapped.
+// Postcondition: Returns the number of shards.
+int ShardCatalog::getShardCount() const { return static_cast<int>(header->shardCount); }
+
+// Precondition: The catalog is mapped.
+// Postcondition: Returns the number of courses in the whole catalog.
+int ShardCatalog::getCourseCount() const { return static_cast<int>(header->courseCount); }
+
+// Precondition: The catalog is mapped and 0 <= `shard` < getShardCount().
+// Postcondition: Returns the number of courses the shard owns.
+int ShardCatalog::shardSize(int shard) const { return shardSizes[shard]; }
+
+// Member function
+// Precondition: The catalog is mapped.
+// Postcondition: Returns the catalog id of the course with the given code, or CourseIndex::NOT_FOUND.
+int ShardCatalog::find(string_view code) const {
+    uint32_t hash = hashString(code);
+    size_t mask = header->slotCount - 1;
+    size_t pos = hash & mask;
+    while (slots[pos].courseId != CourseIndex::NOT_FOUND) {
+        if (slots[pos].hash == hash && getCode(slots[pos].courseId) == code)
+            return slots[pos].courseId;
+        pos = (pos + 1) & mask;
+    }
+    return CourseIndex::NOT_FOUND;
+}
+
+// Getter
+// Precondition: The catalog is mapped and 0 <= `courseId` < getCourseCount().
+// Postcondition: Returns the course's code, pointing into the segment.
+string_view ShardCatalog::getCode(int courseId) const {
+    return string_view(chars + records[courseId].codeOffset, records[courseId].codeLength);
+}
+
+// Precondition: The catalog is mapped and 0 <= `courseId` < getCourseCount().
+// Postcondition: Returns the shard that owns the course.
+int ShardCatalog::getShard(int courseId) const { return records[courseId].shard; }
+
+// Precondition: The catalog is mapped and 0 <= `courseId` < getCourseCount().
+// Postcondition: Returns the course's position among its shard's courses.
+int ShardCatalog::getLocalId(int courseId) const { return records[courseId].localId; }
+
+// Member function
+// Precondition: The catalog is mapped and 0 <= `shard` < getShardCount().
+// Postcondition: Returns the shard's courses in catalog order, with empty rosters; a course's position in
+// the result is its local id.
+vector<Course> ShardCatalog::shardCourses(int shard) const {
+    vector<Course> courseList;
+    courseList.reserve(shardSizes[shard]);
+    for (uint32_t i = 0; i < header->courseCount; i++) {
+        const Record& record = records[i];
+        if (record.shard != shard) continue;
+        courseList.emplace_back(static_cast<int>(courseList.size()), getCode(static_cast<int>(i)),
+                                string_view(chars + record.titleOffset, record.titleLength),
+                                record.enrollSize, record.waitSize);
+    }
+    return courseList;
+}
+
+// Precondition: The catalog is mapped and 0 <= `shard` < getShardCount().
+// Postcondition: Returns true if `courseList` holds exactly the shard's course codes in local id order, as
+// a snapshot saved by the same shard under the same shard count does.
+bool ShardCatalog::matchesShard(int shard, const Course* courseList, int courseCount) const {
+    if (courseCount != shardSizes[shard]) return false;
+    for (uint32_t i = 0; i < header->courseCount; i++) {
+        if (records[i].shard == shard && courseList[records[i].localId].getCode() != getCode(static_cast<int>(i)))
+            return false;
+    }
+    return true;
+}
+
+// Getter
+// Precondition: The catalog is mapped.
+// Postcondition: Returns the size of the segment in bytes.
+size_t ShardCatalog::bytes() const { return mappedBytes; }
@@ -0,0 +1,79 @@
+#ifndef SHARD_CATALOG_H
+#define SHARD_CATALOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "course_registration.h"
+using namespace std;
+
+// The course catalog of one term, laid out flat in a POSIX shared-memory segment so the router and every
+// shard worker map the same bytes instead of each reading and indexing the course file. Courses are split
+// into shards by a hash of their id; a shard worker keeps the rosters and waitlists of its own courses only,
+// so adding shards adds room instead of growing one heap.
+//
+// Segment layout: a Header, then one Record per course in catalog order, then an open-addressing table of
+// code hashes (as in CourseIndex), then the code and title bytes. Every position is an offset, so the
+// segment means the same at any address. The creator fills it once; everyone else attaches read-only. Once
+// every process has attached, the creator can drop the name so a crash leaves nothing behind in /dev/shm.
+class ShardCatalog {
+private:
+    struct Header {
+        char magic[8];
+        uint32_t shardCount;
+        uint32_t courseCount;
+        uint64_t slotCount;         // a power of two
+        uint64_t totalBytes;
+    };
+    struct Record {
+        uint32_t codeOffset;
+        uint32_t codeLength;
+        uint32_t titleOffset;
+        uint32_t titleLength;
+        int32_t enrollSize;         // as read from the course file
+        int32_t waitSize;
+        int32_t shard;
+        int32_t localId;            // position among its shard's courses, which keep catalog order
+    };
+    struct Slot {
+        uint32_t hash;
+        int32_t courseId;           // -1 marks an empty slot
+    };
+
+    string name;
+    bool owner;                     // created the segment; unlinks it when destroyed
+    void* base;
+    size_t mappedBytes;
+    const Header* header;
+    const Record* records;
+    const Slot* slots;
+    const char* chars;
+    vector<int> shardSizes;
+
+    void locate();
+    void release();
+public:
+    static const char MAGIC[8];
+    ShardCatalog();
+    ~ShardCatalog();
+    ShardCatalog(const ShardCatalog&) = delete;
+    ShardCatalog& operator=(const ShardCatalog&) = delete;
+    static int shardOf(int courseId, int shardCount);
+    bool create(const string& segmentName, const Course* courseList, int courseCount, int shardCount);
+    bool attach(const string& segmentName);
+    void unlinkName();
+    int getShardCount() const;
+    int getCourseCount() const;
+    int shardSize(int shard) const;
+    int find(string_view code) const;
+    string_view getCode(int courseId) const;
+    int getShard(int courseId) const;
+    int getLocalId(int courseId) const;
+    vector<Course> shardCourses(int shard) const;
+    bool matchesShard(int shard, const Course* courseList, int courseCount) const;
+    size_t bytes() const;
+};
+
+#endif //SHARD_CATALOG_H
@@ -0,0 +1,192 @@
+// Snapshot store: copy-on-write course views behind an atomically swapped catalog, with epoch-based
+// reclamation of the versions no reader can reach any more.
+
+#include <algorithm>
+#include <thread>
+#include "snapshot.h"
+
+using namespace std;
+
+// SnapshotStore class
+// Constructor
+// Precondition: `courseList` points to `courseCount` valid Course objects and no transaction is running.
+// Postcondition: Snapshot 0 holds a view of every course.
+SnapshotStore::SnapshotStore(const Course* courseList, int courseCount)
+        : courseList(courseList), courseCount(courseCount), current(nullptr), epoch(1),
+          slots(new ReaderSlot[MAX_READERS]), changed(new atomic<bool>[max(1, courseCount)]) {
+    Catalog* catalog = new Catalog{0, {}};
+    for (int first = 0; first < courseCount; first += CHUNK_COURSES) {
+        Chunk* chunk = new Chunk();
+        for (int i = first; i < min(courseCount, first + CHUNK_COURSES); i++)
+            chunk->views[i - first] = takeView(courseList[i]);
+        catalog->chunks.push_back(chunk);
+    }
+    for (int i = 0; i < courseCount; i++)
+        changed[i].store(false, memory_order_relaxed);
+    current.store(catalog);
+}
+
+// Destructor
+// Precondition: No Reader is left.
+// Postcondition: Every view, chunk and catalog is freed.
+SnapshotStore::~SnapshotStore() {
+    const Catalog* catalog = current.load();
+    for (const Chunk* chunk : catalog->chunks) {
+        for (const CourseView* view : chunk->views)
+            delete view;
+        delete chunk;
+    }
+    delete catalog;
+    for (Retired& entry : retired) {
+        for (const CourseView* view : entry.views)
+            delete view;
+        for (const Chunk* chunk : entry.chunks)
+            delete chunk;
+        delete entry.catalog;
+    }
+}
+
+// Precondition: No transaction is changing `course`.
+// Postcondition: Returns a new view of the course as it is now.
+CourseView* SnapshotStore::takeView(const Course& course) {
+    const vector<Student*>& enrolled = course.getRoster().getItems();
+    return new CourseView{&course, course.getVersion(), course.getEnrollSize(), course.getWaitSize(),
+                          vector<const Student*>(enrolled.begin(), enrolled.end()),
+                          course.getWaitList().getEntries()};
+}
+
+// Member function
+// Precondition: `courseId` is a valid course id. Safe to call from any number of threads.
+// Postcondition: The course is copied into a new view by the next publish().
+void SnapshotStore::markChanged(int courseId) {
+    if (changed[courseId].exchange(true, memory_order_relaxed)) return;
+    lock_guard<mutex> guard(changedLock);
+    changedCourses.push_back(courseId);
+}
+
+// Precondition: Called by one thread at a time while no transaction is running.
+// Postcondition: Readers that start from now on see every course as it is now; returns the new snapshot's
+// sequence number (unchanged when no course changed). Versions that no reader can reach are freed.
+uint64_t SnapshotStore::publish() {
+    vector<int> ids;
+    {
+        lock_guard<mutex> guard(changedLock);
+        ids.swap(changedCourses);
+    }
+    const Catalog* old = current.load();
+    if (ids.empty()) {
+        reclaim();
+        return old->sequence;
+    }
+    sort(ids.begin(), ids.end());
+    Catalog* next = new Catalog{old->sequence + 1, old->chunks};
+    Retired replaced{0, old, {}, {}};
+    Chunk* copy = nullptr;
+    int copyIndex = -1;
+    for (int courseId : ids) {
+        changed[courseId].store(false, memory_order_relaxed);
+        int chunkIndex = courseId / CHUNK_COURSES;
+        // The ids are sorted, so every touched chunk is copied exactly once
+        if (chunkIndex != copyIndex) {
+            copy = new Chunk(*old->chunks[chunkIndex]);
+            copyIndex = chunkIndex;
+            replaced.chunks.push_back(old->chunks[chunkIndex]);
+            next->chunks[chunkIndex] = copy;
+        }
+        const CourseView*& slot = copy->views[courseId % CHUNK_COURSES];
+        replaced.views.push_back(slot);
+        slot = takeView(courseList[courseId]);
+    }
+    current.store(next);
+    // Readers that announce a later epoch load the catalog after this swap
+    replaced.epoch = epoch.fetch_add(1);
+    retired.push_back(move(replaced));
+    reclaim();
+    return next->sequence;
+}
+
+// Precondition: Called from publish().
+// Postcondition: Every retired version older than the oldest announced epoch is freed.
+void SnapshotStore::reclaim() {
+    uint64_t oldest = UINT64_MAX;
+    for (int i = 0; i < MAX_READERS; i++) {
+        uint64_t announced = slots[i].epoch.load();
+        if (announced != 0)
+            oldest = min(oldest, announced);
+    }
+    size_t freed = 0;
+    for (; freed < retired.size() && retired[freed].epoch < oldest; freed++) {
+        for (const CourseView* view : retired[freed].views)
+            delete view;
+        for (const Chunk* chunk : retired[freed].chunks)
+            delete chunk;
+        delete retired[freed].catalog;
+    }
+    retired.erase(retired.begin(), retired.begin() + freed);
+}
+
+// Precondition: None.
+// Postcondition: Claims a free reader slot and announces the current epoch in it, checking afterwards that
+// the epoch did not move on meanwhile; returns the slot. Waits for a slot when MAX_READERS readers are active.
+size_t SnapshotStore::pin() {
+    while (true) {
+        for (size_t i = 0; i < MAX_READERS; i++) {
+            uint64_t free = 0;
+            uint64_t announced = epoch.load();
+            if (!slots[i].epoch.compare_exchange_strong(free, announced)) continue;
+            uint64_t now;
+            while ((now = epoch.load()) != announced) {
+                announced = now;
+                slots[i].epoch.store(announced);
+            }
+            return i;
+        }
+        this_thread::yield();
+    }
+}
+
+// Precondition: None. Safe to call from any number of threads.
+// Postcondition: Returns a Reader pinned to the latest published snapshot.
+SnapshotStore::Reader SnapshotStore::read() { return Reader(*this); }
+
+// Getter
+// Precondition: Called by the publishing thread.
+// Postcondition: Returns the number of published versions still waiting for their readers to finish.
+size_t SnapshotStore::retiredCount() const { return retired.size(); }
+
+// Reader class
+// Constructor
+// Precondition: None.
+// Postcondition: The latest published catalog is pinned until the Reader is destroyed.
+SnapshotStore::Reader::Reader(SnapshotStore& snapshotStore)
+        : store(&snapshotStore), slot(snapshotStore.pin()), catalog(snapshotStore.current.load()) {}
+
+// Precondition: None.
+// Postcondition: This Reader takes over `other`'s pin; `other` no longer holds one.
+SnapshotStore::Reader::Reader(Reader&& other) noexcept
+        : store(other.store), slot(other.slot), catalog(other.catalog) {
+    other.store = nullptr;
+}
+
+// Destructor
+// Precondition: None.
+// Postcondition: The pin is released, so publish() may free what only this Reader could reach.
+SnapshotStore::Reader::~Reader() {
+    if (store != nullptr)
+        store->slots[slot].epoch.store(0, memory_order_release);
+}
+
+// Getter
+// Precondition: The Reader holds a pin.
+// Postcondition: Returns the snapshot's sequence number; each publish() that changed something adds one.
+uint64_t SnapshotStore::Reader::sequence() const { return catalog->sequence; }
+
+// Precondition: The Reader holds a pin.
+// Postcondition: Returns the number of courses in the snapshot.
+int SnapshotStore::Reader::courseCount() const { return store->courseCount; }
+
+// Precondition: The Reader holds a pin and 0 <= `courseId` < courseCount().
+// Postcondition: Returns the course's view in this snapshot; it stays valid while the Reader lives.
+const CourseView& SnapshotStore::Reader::view(int courseId) const {
+    return *catalog->chunks[courseId / CHUNK_COURSES]->views[courseId % CHUNK_COURSES];
+}
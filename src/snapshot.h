@@ -0,0 +1,102 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "course_registration.h"
+using namespace std;
+
+// Immutable copy of one course's enrollment as of one published snapshot.
+struct CourseView {
+    const Course* course;               // for the code and title only, which never change after loading
+    uint64_t version;                   // Course::getVersion() when the view was taken
+    int enrollSize;
+    int waitSize;
+    vector<const Student*> enrolled;    // id order
+    vector<WaitList::Entry> waiting;    // heap order, copied as is; sort with WaitList::before for promotion order
+};
+
+// Read-only snapshots of every course roster and waitlist, published by the writer and read by any number
+// of threads without taking course locks.
+//
+// Writers call markChanged() for every course they change. Whoever needs readers to see the latest state
+// calls publish() while no transaction is running; it copies only the courses changed since the last
+// publish into new views and swaps in a new catalog that shares every other view with the previous one
+// (views are grouped in chunks of CHUNK_COURSES, so a publish copies the touched chunks and the short chunk
+// table, never the whole catalog). Copies are flat: waitlists are taken in heap order and left for the
+// reader to sort. Readers pin the current catalog with read() and see one consistent state of all courses
+// for as long as they hold the Reader.
+//
+// Replaced views, chunks and catalogs are reclaimed by epochs: a Reader announces the epoch it started in,
+// publish() retires the old objects under the epoch that ended with the swap, and frees them once no Reader
+// from that epoch or earlier is left. Readers never wait for the writer; the writer never waits for readers.
+class SnapshotStore {
+private:
+    static const int CHUNK_COURSES = 256;
+    struct Chunk {
+        const CourseView* views[CHUNK_COURSES];
+    };
+    struct Catalog {
+        uint64_t sequence;
+        vector<const Chunk*> chunks;
+    };
+    struct Retired {
+        uint64_t epoch;
+        const Catalog* catalog;
+        vector<const Chunk*> chunks;
+        vector<const CourseView*> views;
+    };
+    // One announced epoch per active Reader, each on its own cache line; 0 means the slot is free
+    struct alignas(64) ReaderSlot {
+        atomic<uint64_t> epoch{0};
+    };
+
+    const Course* courseList;
+    int courseCount;
+    atomic<const Catalog*> current;
+    atomic<uint64_t> epoch;
+    unique_ptr<ReaderSlot[]> slots;
+    vector<Retired> retired;            // oldest first; touched by publish() only
+    unique_ptr<atomic<bool>[]> changed;
+    mutex changedLock;
+    vector<int> changedCourses;
+
+    static CourseView* takeView(const Course& course);
+    size_t pin();
+    void reclaim();
+public:
+    static const int MAX_READERS = 64;
+
+    // A pinned snapshot. Hold it only as long as needed: views it can reach are not freed until it is gone.
+    class Reader {
+    private:
+        SnapshotStore* store;
+        size_t slot;
+        const Catalog* catalog;
+    public:
+        Reader(SnapshotStore& snapshotStore);
+        Reader(Reader&& other) noexcept;
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+        Reader& operator=(Reader&&) = delete;
+        ~Reader();
+        uint64_t sequence() const;
+        int courseCount() const;
+        const CourseView& view(int courseId) const;
+    };
+
+    SnapshotStore(const Course* courseList, int courseCount);
+    ~SnapshotStore();
+    SnapshotStore(const SnapshotStore&) = delete;
+    SnapshotStore& operator=(const SnapshotStore&) = delete;
+    void markChanged(int courseId);
+    uint64_t publish();
+    Reader read();
+    size_t retiredCount() const;
+};
+
+#endif //SNAPSHOT_H
@@ -0,0 +1,25 @@
+#ifndef SPIN_LOCK_H
+#define SPIN_LOCK_H
+
+#include <atomic>
+#include <thread>
+using namespace std;
+
+// One-byte lock for very short critical sections, such as updating a single student's schedule.
+// Satisfies BasicLockable, so it works with lock_guard.
+class SpinLock {
+private:
+    atomic<bool> locked{false};
+public:
+    void lock() {
+        while (locked.exchange(true, memory_order_acquire)) {
+            while (locked.load(memory_order_relaxed))
+                this_thread::yield();
+        }
+    }
+    void unlock() {
+        locked.store(false, memory_order_release);
+    }
+};
+
+#endif //SPIN_LOCK_H
@@ -0,0 +1,69 @@
+// Append-only string storage shared by every Student and Course record.
+
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <sys/mman.h>
+#include "string_arena.h"
+
+using namespace std;
+
+// Precondition: None.
+// Postcondition: Returns the 32-bit FNV-1a hash of `text`.
+uint32_t hashString(string_view text) {
+    uint32_t hash = 2166136261u;
+    for (char c : text) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// StringArena class
+// Constructor
+// Precondition: None.
+// Postcondition: Reserves RESERVED_BYTES of address space for the strings; no memory is committed yet.
+// Throws bad_alloc if the address space cannot be reserved.
+StringArena::StringArena() : base(nullptr), used(0) {
+    void* region = mmap(nullptr, RESERVED_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                        -1, 0);
+    if (region == MAP_FAILED)
+        throw bad_alloc();
+    base = static_cast<char*>(region);
+}
+
+// Destructor
+// Precondition: No view of this arena is used afterwards.
+// Postcondition: The reserved region is released.
+StringArena::~StringArena() {
+    munmap(base, RESERVED_BYTES);
+}
+
+// Precondition: None.
+// Postcondition: Returns the arena used by all Student and Course records. It is never destroyed, so views
+// stay valid until the process exits.
+StringArena& StringArena::shared() {
+    static StringArena* arena = new StringArena();
+    return *arena;
+}
+
+// Member function
+// Precondition: None. Safe to call from any number of threads.
+// Postcondition: Copies `text` to a fresh range of the arena and returns its ref.
+// Throws length_error if the arena is full.
+StringRef StringArena::store(string_view text) {
+    if (text.empty())
+        return StringRef{0, 0};
+    size_t offset = used.fetch_add(text.size());
+    if (offset + text.size() > RESERVED_BYTES)
+        throw length_error("string arena is full");
+    memcpy(base + offset, text.data(), text.size());
+    return StringRef{static_cast<uint32_t>(offset), static_cast<uint32_t>(text.size())};
+}
+
+// Getter
+// Precondition: None.
+// Postcondition: Returns the number of string bytes stored.
+size_t StringArena::bytesUsed() const {
+    return used.load();
+}
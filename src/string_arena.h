@@ -0,0 +1,39 @@
+#ifndef STRING_ARENA_H
+#define STRING_ARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+using namespace std;
+
+// A string stored in a StringArena: eight bytes instead of a 32-byte std::string (plus its heap block
+// once the text outgrows the inline buffer).
+struct StringRef {
+    uint32_t offset;
+    uint32_t length;
+};
+
+uint32_t hashString(string_view text);
+
+// Append-only storage for student names, course codes and course titles.
+// The bytes live in one contiguous region reserved up front (and committed by the OS page by page as
+// it fills), so a stored string never moves, a record refers to it by a 32-bit offset, and view()
+// needs no lock. Nothing is freed before the program exits.
+class StringArena {
+private:
+    char* base;
+    atomic<size_t> used;
+public:
+    static const size_t RESERVED_BYTES = size_t(1) << 32;
+    StringArena();
+    ~StringArena();
+    StringArena(const StringArena&) = delete;
+    StringArena& operator=(const StringArena&) = delete;
+    static StringArena& shared();
+    StringRef store(string_view text);
+    string_view view(StringRef ref) const { return string_view(base + ref.offset, ref.length); }
+    size_t bytesUsed() const;
+};
+
+#endif //STRING_ARENA_H
@@ -0,0 +1,66 @@
+// Central registry that owns all Student records.
+
+#include <mutex>
+#include "student_registry.h"
+
+using namespace std;
+
+// StudentRegistry class
+// Member function
+// Precondition: The caller holds `lock`, shared or exclusive.
+// Postcondition: Returns the record with the given id and name, or nullptr if there is none.
+Student* StudentRegistry::findLocked(int id, string_view name) const {
+    auto range = byId.equal_range(id);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second->getName() == name)
+            return it->second;
+    }
+    return nullptr;
+}
+
+// Precondition: None.
+// Postcondition: Returns the record with the given id and name, or nullptr if there is none.
+Student* StudentRegistry::find(int id, string_view name) const {
+    shared_lock<shared_mutex> reader(lock);
+    return findLocked(id, name);
+}
+
+// Precondition: None.
+// Postcondition: Returns the existing record with the given id and name, or creates one in the pool.
+Student* StudentRegistry::findOrAdd(int id, string_view name) {
+    Student* student = find(id, name);
+    if (student != nullptr) return student;
+    unique_lock<shared_mutex> writer(lock);
+    // Another thread may have added the student between the two locks
+    student = findLocked(id, name);
+    if (student != nullptr) return student;
+    pool.emplace_back(id, name);
+    student = &pool.back();
+    byId.emplace(id, student);
+    return student;
+}
+
+// Precondition: No record has this id and name yet (as when restoring a snapshot, whose students are distinct).
+// Postcondition: Creates the record in the pool and returns it, without searching for an existing one.
+Student* StudentRegistry::add(int id, string_view name) {
+    unique_lock<shared_mutex> writer(lock);
+    pool.emplace_back(id, name);
+    Student* student = &pool.back();
+    byId.emplace(id, student);
+    return student;
+}
+
+// Precondition: None.
+// Postcondition: The id index has room for `count` students without rehashing.
+void StudentRegistry::reserve(int count) {
+    unique_lock<shared_mutex> writer(lock);
+    byId.reserve(count);
+}
+
+// Getter
+// Precondition: None.
+// Postcondition: Returns the number of distinct students in the registry.
+int StudentRegistry::size() const {
+    shared_lock<shared_mutex> reader(lock);
+    return static_cast<int>(pool.size());
+}
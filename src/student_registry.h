@@ -0,0 +1,33 @@
+#ifndef STUDENT_REGISTRY_H
+#define STUDENT_REGISTRY_H
+
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "course_registration.h"
+using namespace std;
+
+// Owns every Student record. Records live in a chunked pool, so their addresses never change and
+// courses can hold plain Student* handles; all records are released together with the registry.
+// A student is identified by id and name, matching Student::equals.
+// Lookups may run concurrently; adding a student takes the lock exclusively.
+class StudentRegistry {
+private:
+    deque<Student> pool;
+    unordered_multimap<int, Student*> byId;
+    mutable shared_mutex lock;
+    Student* findLocked(int id, string_view name) const;
+public:
+    StudentRegistry() = default;
+    StudentRegistry(const StudentRegistry&) = delete;
+    StudentRegistry& operator=(const StudentRegistry&) = delete;
+    Student* find(int id, string_view name) const;
+    Student* findOrAdd(int id, string_view name);
+    Student* add(int id, string_view name);
+    void reserve(int count);
+    int size() const;
+};
+
+#endif //STUDENT_REGISTRY_H